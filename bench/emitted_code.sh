@@ -0,0 +1,51 @@
+#!/bin/bash
+# Compiles a program twice, once with its loops and ifs recovered and once as
+# the labels and gotos they were lowered to, builds both with cc -O2 and runs
+# each a few times. Prints the best time of each in ms. The program can't read
+# any input.
+#
+# Usage: bench/emitted_code.sh compiler source.txt [runs]
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 compiler source.txt [runs]" >&2
+    exit 1
+fi
+
+compiler=$1
+source=$2
+runs=${3:-10}
+
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+
+# Best wall time of running a program, in ns
+best_time()
+{
+    local best=""
+    
+    for ((i = 0; i < runs; ++i)); do
+        local start=$(date +%s%N)
+        "$1" < /dev/null > /dev/null || return 1
+        local time=$(($(date +%s%N) - start))
+        
+        if [ -z "$best" ] || [ $time -lt $best ]; then
+            best=$time
+        fi
+    done
+    
+    echo $best
+}
+
+for form in gotos structured; do
+    flags=""
+    [ $form = gotos ] && flags=--gotos
+    
+    "$compiler" "$source" "$dir/$form.c" $flags > /dev/null || exit 1
+    ${CC:-cc} -O2 -w -o "$dir/$form" "$dir/$form.c" || exit 1
+    
+    time=$(best_time "$dir/$form") || { echo "$form: the program failed" >&2; exit 1; }
+    eval "${form}_time=$time"
+    printf "Emitted code, %s: %d.%03d ms\n" $form $((time / 1000000)) $((time / 1000 % 1000))
+done
+
+awk -v a=$gotos_time -v b=$structured_time 'BEGIN { printf "Structured vs gotos: %.2fx\n", a / b }'
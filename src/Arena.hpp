@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <vector>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
+#include <typeinfo>
+#include <cxxabi.h>
+
+// Bump allocator that owns every node of an Ast. Objects are carved out of
+// large chunks and the chunks are released all at once when the arena dies.
+// Only objects that aren't trivially destructible (ones that own strings, sets,
+// etc.) have their destructor run at teardown.
+class Arena
+{
+public:
+    Arena() : current(nullptr), remaining(0), totalBytes(0) { }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    template<typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        T* obj = new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+        if(!std::is_trivially_destructible<T>::value)
+            destructors.push_back(std::make_pair((void*)obj, &destroy<T>));
+
+        recordAllocation(getTypeSlot<T>(), sizeof(T));
+
+        return obj;
+    }
+
+    void* allocate(size_t size, size_t align)
+    {
+        size_t padding = (align - ((uintptr_t)current & (align - 1))) & (align - 1);
+
+        if(padding + size > remaining)
+        {
+            newChunk(size + align);
+            padding = (align - ((uintptr_t)current & (align - 1))) & (align - 1);
+        }
+
+        char* mem = current + padding;
+        current = mem + size;
+        remaining -= padding + size;
+        totalBytes += size;
+
+        return mem;
+    }
+
+    size_t getTotalBytes()
+    {
+        return totalBytes;
+    }
+
+    void printStats()
+    {
+        printf("============Arena stats============\n");
+
+        for(int i = 0; i < (int)kindStats.size(); ++i)
+        {
+            if(kindStats[i].count == 0)
+                continue;
+
+            printf("%-32s %8d nodes %10d bytes\n", getTypeNames()[i].c_str(), kindStats[i].count, (int)kindStats[i].bytes);
+        }
+
+        printf("Total: %d bytes in %d chunks\n", (int)totalBytes, (int)chunks.size());
+        printf("===================================\n");
+    }
+
+    ~Arena()
+    {
+        for(auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+            it->second(it->first);
+
+        for(char* chunk : chunks)
+            free(chunk);
+    }
+
+private:
+    struct KindStats
+    {
+        KindStats() : count(0), bytes(0) { }
+
+        int count;
+        size_t bytes;
+    };
+
+    static const size_t CHUNK_SIZE = 64 * 1024;
+
+    void newChunk(size_t minSize)
+    {
+        // std::max would take CHUNK_SIZE by reference, which needs a
+        // definition of it outside the class
+        size_t chunkSize = CHUNK_SIZE;
+        size_t size = std::max(minSize, chunkSize);
+        char* chunk = (char*)malloc(size);
+
+        if(!chunk)
+            throw std::bad_alloc();
+
+        chunks.push_back(chunk);
+        current = chunk;
+        remaining = size;
+    }
+
+    void recordAllocation(int slot, size_t size)
+    {
+        if(slot >= (int)kindStats.size())
+            kindStats.resize(slot + 1);
+
+        ++kindStats[slot].count;
+        kindStats[slot].bytes += size;
+    }
+
+    static std::vector<std::string>& getTypeNames()
+    {
+        static std::vector<std::string> names;
+        return names;
+    }
+
+    template<typename T>
+    static void destroy(void* obj)
+    {
+        ((T*)obj)->~T();
+    }
+
+    template<typename T>
+    static int getTypeSlot()
+    {
+        static int slot = registerTypeName(typeid(T).name());
+        return slot;
+    }
+
+    static int registerTypeName(const char* mangledName)
+    {
+        int status;
+        char* demangled = abi::__cxa_demangle(mangledName, nullptr, nullptr, &status);
+
+        getTypeNames().push_back(status == 0 ? demangled : mangledName);
+        free(demangled);
+
+        return getTypeNames().size() - 1;
+    }
+
+    char* current;
+    size_t remaining;
+    size_t totalBytes;
+    std::vector<char*> chunks;
+    std::vector<std::pair<void*, void (*)(void*)>> destructors;
+    std::vector<KindStats> kindStats;
+};
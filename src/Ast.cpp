@@ -1,6 +1,8 @@
 #include "Ast.hpp"
 #include "AstVisitor.hpp"
+#include "AstWalker.hpp"
 #include "BasicBlockBuilder.hpp"
+#include "CfgSimplifier.hpp"
 #include "VariableUsageCounter.hpp"
 #include "Utils.hpp"
 
@@ -18,6 +20,14 @@ void Ast::splitIntoBasicBlocks()
 {
     BasicBlockBuilder builder(*this);
     setBody(builder.buildBasicBlocks());
+    
+    CfgSimplifier simplifier(body, *this);
+    simplifier.simplify();
+}
+
+bool StatementNode::inDeadCode()
+{
+    return markedAsDead || (parentBlock != nullptr && parentBlock->markedAsDead);
 }
 
 void IntegerNode::accept(AstVisitor& visitor)
@@ -57,11 +67,17 @@ void OneDimensionalListFactor::accept(AstVisitor& visitor)
 
 void OneDimensionalListFactor::acceptRecursive(AstVisitor& v)
 {
+    if(v.isTooDeepToRecurse())
+    {
+        AstWalker::walk(this, v);
+        return;
+    }
+    
     v.visit(this);
     
     v.enterNode(index);
     index->acceptRecursive(v);
-    index = dynamic_cast<ExpressionNode*>(v.lastNode());
+    index = cast<ExpressionNode>(v.lastNode());
     v.exitNode(index);
 }
 
@@ -72,16 +88,22 @@ void TwoDimensionalListFactor::accept(AstVisitor& visitor)
 
 void TwoDimensionalListFactor::acceptRecursive(AstVisitor& v)
 {
+    if(v.isTooDeepToRecurse())
+    {
+        AstWalker::walk(this, v);
+        return;
+    }
+    
     v.visit(this);
     
     v.enterNode(index0);
     index0->acceptRecursive(v);
-    index0 = dynamic_cast<ExpressionNode*>(v.lastNode());
+    index0 = cast<ExpressionNode>(v.lastNode());
     v.exitNode(index0);
     
     v.enterNode(index1);
     index1->acceptRecursive(v);
-    index1 = dynamic_cast<ExpressionNode*>(v.lastNode());
+    index1 = cast<ExpressionNode>(v.lastNode());
     v.exitNode(index1);
 }
 
@@ -92,24 +114,87 @@ void ThreeDimensionalListFactor::accept(AstVisitor& visitor)
 
 void ThreeDimensionalListFactor::acceptRecursive(AstVisitor& v)
 {
+    if(v.isTooDeepToRecurse())
+    {
+        AstWalker::walk(this, v);
+        return;
+    }
+    
     v.visit(this);
     
     v.enterNode(index0);
     index0->acceptRecursive(v);
-    index0 = dynamic_cast<ExpressionNode*>(v.lastNode());
+    index0 = cast<ExpressionNode>(v.lastNode());
     v.exitNode(index0);
     
     v.enterNode(index1);
     index1->acceptRecursive(v);
-    index1 = dynamic_cast<ExpressionNode*>(v.lastNode());
+    index1 = cast<ExpressionNode>(v.lastNode());
     v.exitNode(index1);
     
     v.enterNode(index2);
     index2->acceptRecursive(v);
-    index2 = dynamic_cast<ExpressionNode*>(v.lastNode());
+    index2 = cast<ExpressionNode>(v.lastNode());
     v.exitNode(index2);
 }
 
+bool ExpressionNode::tryEvaluateOperators(ExpressionNode* root, int& result)
+{
+    // An operator is on the work stack twice: first to push its operands, then
+    // to apply it once their values are on the value stack
+    std::vector<std::pair<ExpressionNode*, bool>> work;
+    std::vector<int> values;
+    
+    work.push_back(std::make_pair(root, false));
+    
+    while(work.size() != 0)
+    {
+        ExpressionNode* node = work.back().first;
+        bool operandsDone = work.back().second;
+        work.pop_back();
+        
+        if(BinaryOpNode* binaryOp = dyn_cast<BinaryOpNode>(node))
+        {
+            if(!operandsDone)
+            {
+                work.push_back(std::make_pair(node, true));
+                work.push_back(std::make_pair(binaryOp->right, false));
+                work.push_back(std::make_pair(binaryOp->left, false));
+                continue;
+            }
+            
+            int right = values.back();
+            values.pop_back();
+            
+            if(!BinaryOpNode::evaluate(binaryOp->op, values.back(), right, values.back()))
+                return false;
+        }
+        else if(UnaryOpNode* unaryOp = dyn_cast<UnaryOpNode>(node))
+        {
+            if(!operandsDone)
+            {
+                work.push_back(std::make_pair(node, true));
+                work.push_back(std::make_pair(unaryOp->value, false));
+                continue;
+            }
+            
+            if(!UnaryOpNode::evaluate(unaryOp->op, values.back(), values.back()))
+                return false;
+        }
+        else
+        {
+            int value;
+            if(!node->tryEvaluate(value))
+                return false;
+                
+            values.push_back(value);
+        }
+    }
+    
+    result = values.back();
+    return true;
+}
+
 void BinaryOpNode::accept(AstVisitor& visitor)
 {
     visitor.visit(this);
@@ -117,14 +202,20 @@ void BinaryOpNode::accept(AstVisitor& visitor)
 
 void BinaryOpNode::acceptRecursive(AstVisitor& v)
 {    
+    if(v.isTooDeepToRecurse())
+    {
+        AstWalker::walk(this, v);
+        return;
+    }
+    
     v.enterNode(left);
     left->acceptRecursive(v);
-    left = dynamic_cast<ExpressionNode*>(v.lastNode());
+    left = cast<ExpressionNode>(v.lastNode());
     v.exitNode(left);
     
     v.enterNode(right);
     right->acceptRecursive(v);
-    right = dynamic_cast<ExpressionNode*>(v.lastNode());
+    right = cast<ExpressionNode>(v.lastNode());
     v.exitNode(right);
     
     v.visit(this);
@@ -137,9 +228,15 @@ void UnaryOpNode::accept(AstVisitor& visitor)
 
 void UnaryOpNode::acceptRecursive(AstVisitor& v)
 {    
+    if(v.isTooDeepToRecurse())
+    {
+        AstWalker::walk(this, v);
+        return;
+    }
+    
     v.enterNode(value);
     value->acceptRecursive(v);
-    value = dynamic_cast<ExpressionNode*>(v.lastNode());
+    value = cast<ExpressionNode>(v.lastNode());
     v.exitNode(value);
     
     v.visit(this);
@@ -178,6 +275,12 @@ void LetStatementNode::accept(AstVisitor& visitor)
 
 void LetStatementNode::acceptRecursive(AstVisitor& visitor)
 {
+    if(visitor.isTooDeepToRecurse())
+    {
+        AstWalker::walk(this, visitor);
+        return;
+    }
+    
     if(visitor.visitLetBefore)
     {
         visitor.visit(this);
@@ -186,12 +289,12 @@ void LetStatementNode::acceptRecursive(AstVisitor& visitor)
     
     visitor.enterNode(leftSide);
     leftSide->acceptRecursive(visitor);
-    leftSide = dynamic_cast<LValueNode*>(visitor.lastNode());
+    leftSide = cast<LValueNode>(visitor.lastNode());
     visitor.exitNode(leftSide);
     
     visitor.enterNode(rightSide);
     rightSide->acceptRecursive(visitor);
-    rightSide = dynamic_cast<ExpressionNode*>(visitor.lastNode());
+    rightSide = cast<ExpressionNode>(visitor.lastNode());
     visitor.exitNode(rightSide);
     
     if(!visitor.visitLetBefore)
@@ -239,20 +342,51 @@ void IfNode::accept(AstVisitor& visitor)
 
 void IfNode::acceptRecursive(AstVisitor& visitor)
 {
+    if(visitor.isTooDeepToRecurse())
+    {
+        AstWalker::walk(this, visitor);
+        return;
+    }
+    
     visitor.visit(this);
     visitor.visit((StatementNode*)this);
     
     visitor.enterNode(condition);
     condition->acceptRecursive(visitor);
-    condition = dynamic_cast<ExpressionNode*>(visitor.lastNode());
+    condition = cast<ExpressionNode>(visitor.lastNode());
     visitor.exitNode(condition);
     
     visitor.enterNode(body);
     body->acceptRecursive(visitor);
-    body = dynamic_cast<StatementNode*>(visitor.lastNode());
+    body = cast<StatementNode>(visitor.lastNode());
     visitor.exitNode(body);
 }
 
+void IfNode::invertCondition(Ast& ast)
+{
+    auto node = dyn_cast<BinaryOpNode>(condition);
+    if(!node)
+        throw "Can't invert condition: not a binary of node";
+        
+    TokenType op;
+    
+    switch(node->op)
+    {
+        case TOK_LT: op = TOK_GE; break;
+        case TOK_LE: op = TOK_GT; break;
+        case TOK_EQ: op = TOK_NE; break;
+        case TOK_NE: op = TOK_EQ; break;
+        case TOK_GT: op = TOK_LE; break;
+        case TOK_GE: op = TOK_LT; break;
+        default: throw "Can't invert condition: un-invertable operator " + Token::getTokenName(node->op);
+    }
+    
+    if(node->shared)
+        condition = ast.newBinaryOpNode(node->left, op, node->right);
+    else
+        node->op = op;
+}
+
 void PrintNode::accept(AstVisitor& visitor)
 {
     visitor.visit(this);
@@ -275,6 +409,12 @@ void RemNode::accept(AstVisitor& visitor)
 
 void CodeBlockNode::acceptRecursive(AstVisitor& v)
 {
+    if(v.isTooDeepToRecurse())
+    {
+        AstWalker::walk(this, v);
+        return;
+    }
+    
     v.visit(this);
     v.visit((StatementNode*)this);
     
@@ -282,16 +422,22 @@ void CodeBlockNode::acceptRecursive(AstVisitor& v)
     {
         if(node->markedAsDead)
             continue;
-        
+            
         v.enterNode(node);
         node->acceptRecursive(v);
-        node = dynamic_cast<StatementNode*>(v.lastNode());
+        node = cast<StatementNode>(v.lastNode());
         v.exitNode(node);
     }
 }
 
 void BasicBlockNode::acceptRecursive(AstVisitor& v)
 {
+    if(v.isTooDeepToRecurse())
+    {
+        AstWalker::walk(this, v);
+        return;
+    }
+    
     v.visit(this);
     v.visit((StatementNode*)this);
     
@@ -299,10 +445,10 @@ void BasicBlockNode::acceptRecursive(AstVisitor& v)
     {
         if(node->markedAsDead)
             continue;
-        
+            
         v.enterNode(node);
         node->acceptRecursive(v);
-        node = dynamic_cast<StatementNode*>(v.lastNode());
+        node = cast<StatementNode>(v.lastNode());
         v.exitNode(node);
     }
 }
@@ -314,46 +460,64 @@ void IntLValueNode::acceptRecursive(AstVisitor& visitor)
 
 void OneDimensionalListLValueNode::acceptRecursive(AstVisitor& v)
 {
+    if(v.isTooDeepToRecurse())
+    {
+        AstWalker::walk(this, v);
+        return;
+    }
+    
     v.visit(this);
     
     v.enterNode(index);
     index->acceptRecursive(v);
-    index = dynamic_cast<ExpressionNode*>(v.lastNode());
+    index = cast<ExpressionNode>(v.lastNode());
     v.exitNode(index);
 }
 
 void TwoDimensionalListLValueNode::acceptRecursive(AstVisitor& v)
 {
+    if(v.isTooDeepToRecurse())
+    {
+        AstWalker::walk(this, v);
+        return;
+    }
+    
     v.visit(this);
     
     v.enterNode(index0);
     index0->acceptRecursive(v);
-    index0 = dynamic_cast<ExpressionNode*>(v.lastNode());
+    index0 = cast<ExpressionNode>(v.lastNode());
     v.exitNode(index0);
     
     v.enterNode(index1);
     index1->acceptRecursive(v);
-    index1 = dynamic_cast<ExpressionNode*>(v.lastNode());
+    index1 = cast<ExpressionNode>(v.lastNode());
     v.exitNode(index1);
 }
 
 void ThreeDimensionalListLValueNode::acceptRecursive(AstVisitor& v)
 {
+    if(v.isTooDeepToRecurse())
+    {
+        AstWalker::walk(this, v);
+        return;
+    }
+    
     v.visit(this);
     
     v.enterNode(index0);
     index0->acceptRecursive(v);
-    index0 = dynamic_cast<ExpressionNode*>(v.lastNode());
+    index0 = cast<ExpressionNode>(v.lastNode());
     v.exitNode(index0);
     
     v.enterNode(index1);
     index1->acceptRecursive(v);
-    index1 = dynamic_cast<ExpressionNode*>(v.lastNode());
+    index1 = cast<ExpressionNode>(v.lastNode());
     v.exitNode(index1);
     
     v.enterNode(index2);
     index2->acceptRecursive(v);
-    index2 = dynamic_cast<ExpressionNode*>(v.lastNode());
+    index2 = cast<ExpressionNode>(v.lastNode());
     v.exitNode(index2);
 }
 
@@ -365,23 +529,35 @@ void PromptNode::acceptRecursive(AstVisitor& v)
 
 void PrintNode::acceptRecursive(AstVisitor& v)
 {
+    if(v.isTooDeepToRecurse())
+    {
+        AstWalker::walk(this, v);
+        return;
+    }
+    
     v.visit(this);
     v.visit((StatementNode*)this);
     
     v.enterNode(value);
     value->acceptRecursive(v);
-    value = dynamic_cast<ExpressionNode*>(v.lastNode());
+    value = cast<ExpressionNode>(v.lastNode());
     v.exitNode(value);
 }
 
 void InputNode::acceptRecursive(AstVisitor& v)
 {
+    if(v.isTooDeepToRecurse())
+    {
+        AstWalker::walk(this, v);
+        return;
+    }
+    
     v.visit(this);
     v.visit((StatementNode*)this);
     
     v.enterNode(var);
     var->acceptRecursive(v);
-    var = dynamic_cast<LValueNode*>(v.lastNode());
+    var = cast<LValueNode>(v.lastNode());
     v.exitNode(var);
 }
 
@@ -423,23 +599,23 @@ void InputIntNode::acceptRecursive(AstVisitor& v)
 void Ast::eliminateUnusedVars()
 {
     VariableUsageCounter counter(body, true);
-    auto count = counter.countVarUses();
-    std::map<IntDeclNode*, int> intVarCounts;
+    auto& count = counter.countVarUses();
+    std::vector<int> intVarCounts(vars.size(), 0);
     
-    for(auto var : count)
+    for(int i = 0; i < (int)count.size(); ++i)
     {
-        intVarCounts[var.first->var] += var.second;
+        intVarCounts[ssaValues[i]->var->varId] += count[i];
     }
     
     std::vector<std::string> eliminated;
     
     for(auto var : vars)
     {
-        if(auto intVar = dynamic_cast<IntDeclNode*>(var))
+        if(auto intVar = dyn_cast<IntDeclNode>(var))
         {
-            if(intVarCounts[intVar] == 0)
+            if(intVarCounts[intVar->varId] == 0)
             {
-                
+            
                 intVar->eliminated = true;
                 eliminated.push_back(intVar->name);
             }
@@ -455,10 +631,10 @@ void Ast::eliminateUnusedVars()
 void Ast::defaultInitializeVars()
 {
     std::vector<StatementNode*> varInit;
-
+    
     for(auto var : vars)
     {
-        if(auto intVar = dynamic_cast<IntDeclNode*>(var))
+        if(auto intVar = dyn_cast<IntDeclNode>(var))
         {
             varInit.push_back
             (
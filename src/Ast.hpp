@@ -7,37 +7,137 @@
 #include <algorithm>
 #include <map>
 #include <list>
+#include <cassert>
+#include <climits>
+#include <unordered_map>
 
 #include "Token.hpp"
 #include "Polynomial.hpp"
+#include "Arena.hpp"
+#include "SymbolTable.hpp"
 
 struct AstVisitor;
 
+// Concrete type of every node. Each abstract node type covers a contiguous
+// range of kinds, so a type test is a single (unsigned) compare.
+enum AstNodeKind
+{
+    NODE_INTEGER,
+    NODE_POLYNOMIAL,
+    NODE_INPUT_INT,
+    NODE_ONE_DIMENSIONAL_LIST_FACTOR,
+    NODE_TWO_DIMENSIONAL_LIST_FACTOR,
+    NODE_THREE_DIMENSIONAL_LIST_FACTOR,
+    NODE_PHI,
+    NODE_INT_VAR_FACTOR,
+    NODE_SSA_INT_VAR_FACTOR,
+    NODE_BINARY_OP,
+    NODE_UNARY_OP,
+    
+    NODE_INT_DECL,
+    NODE_ONE_DIMENSIONAL_LIST_DECL,
+    NODE_TWO_DIMENSIONAL_LIST_DECL,
+    NODE_THREE_DIMENSIONAL_LIST_DECL,
+    
+    NODE_INT_LVALUE,
+    NODE_SSA_INT_LVALUE,
+    NODE_ONE_DIMENSIONAL_LIST_LVALUE,
+    NODE_TWO_DIMENSIONAL_LIST_LVALUE,
+    NODE_THREE_DIMENSIONAL_LIST_LVALUE,
+    
+    NODE_END,
+    NODE_LET,
+    NODE_GOTO,
+    NODE_LABEL,
+    NODE_FOR,
+    NODE_WHILE,
+    NODE_IF,
+    NODE_PRINT,
+    NODE_PROMPT,
+    NODE_INPUT,
+    NODE_REM,
+    NODE_CODE_BLOCK,
+    NODE_BASIC_BLOCK
+};
+
 struct AstNode
 {
+    AstNode(AstNodeKind kind_) : kind(kind_) { }
+    
+    // No virtual destructor: nodes are never deleted through a base pointer,
+    // and the arena destroys each one as its own type. That keeps a node that
+    // only holds pointers and scalars trivially destructible, so the arena can
+    // release it without running anything.
     virtual void accept(AstVisitor& v) { }
     virtual void acceptRecursive(AstVisitor& v) { }
-    virtual ~AstNode() { }
+    
+    const AstNodeKind kind;
+    
+protected:
+    static bool kindInRange(const AstNode* node, AstNodeKind first, AstNodeKind last)
+    {
+        return (unsigned)(node->kind - first) <= (unsigned)(last - first);
+    }
 };
 
+template<typename T>
+inline bool isa(const AstNode* node)
+{
+    return T::classof(node);
+}
+
+template<typename T>
+inline T* cast(AstNode* node)
+{
+    assert(T::classof(node) && "cast to wrong node type");
+    return static_cast<T*>(node);
+}
+
+template<typename T>
+inline T* dyn_cast(AstNode* node)
+{
+    return node != nullptr && T::classof(node) ? static_cast<T*>(node) : nullptr;
+}
+
 struct ExpressionNode : AstNode
 {
-    virtual int tryEvaluate() { throw "Can't evaluate expression"; }
+    ExpressionNode(AstNodeKind kind_) : AstNode(kind_), shared(false) { }
+    
+    static bool classof(const AstNode* node) { return kindInRange(node, NODE_INTEGER, NODE_UNARY_OP); }
+    
+    // Evaluates the expression at compile time. Returns false if the value
+    // isn't known, e.g. it reads a variable or divides by zero.
+    virtual bool tryEvaluate(int& value) { return false; }
     virtual void acceptRecursive(AstVisitor& v) = 0;
     
-    virtual ~ExpressionNode() { }
+protected:
+    // tryEvaluate for the operators. It keeps a stack of its own instead of
+    // recursing, because an expression can be a chain of 100k additions.
+    static bool tryEvaluateOperators(ExpressionNode* root, int& result);
+    
+public:
+    
+    // Hash-consed by the Ast (see Ast::newIntegerNode), so the node may be
+    // used in several places and must never be changed in place. Children of a
+    // shared node only ever get replaced with their folded value, which is the
+    // same everywhere the node is used.
+    bool shared;
 };
 
 struct FactorNode : ExpressionNode
 {
+    FactorNode(AstNodeKind kind_) : ExpressionNode(kind_) { }
     
+    static bool classof(const AstNode* node) { return kindInRange(node, NODE_INTEGER, NODE_SSA_INT_VAR_FACTOR); }
 };
 
 struct IntegerNode : FactorNode
 {
-    IntegerNode(int value_) : value(value_) { }
+    static bool classof(const AstNode* node) { return node->kind == NODE_INTEGER; }
     
-    int tryEvaluate() { return value; }
+    IntegerNode(int value_) : FactorNode(NODE_INTEGER), value(value_) { }
+    
+    bool tryEvaluate(int& result) { result = value; return true; }
     void accept(AstVisitor& v);
     virtual void acceptRecursive(AstVisitor& v);
     
@@ -46,16 +146,17 @@ struct IntegerNode : FactorNode
 
 struct PolynomialNode : FactorNode
 {
-    PolynomialNode(Polynomial poly_) : poly(poly_) { }
+    static bool classof(const AstNode* node) { return node->kind == NODE_POLYNOMIAL; }
+    
+    PolynomialNode(Polynomial poly_) : FactorNode(NODE_POLYNOMIAL), poly(poly_) { }
     
-    int tryEvaluate()
+    bool tryEvaluate(int& value)
     {
-        if(poly.onlyConstant())
-        {
-            return poly.coeff["constant"];
-        }
-        
-        throw "Non constant poly";
+        if(!poly.onlyConstant())
+            return false;
+            
+        value = poly.coeff["constant"];
+        return true;
     }
     
     void accept(AstVisitor& v);
@@ -68,7 +169,9 @@ struct IntDeclNode;
 
 struct IntVarFactor : FactorNode
 {
-    IntVarFactor(IntDeclNode* var_) : var(var_) { }
+    static bool classof(const AstNode* node) { return kindInRange(node, NODE_INT_VAR_FACTOR, NODE_SSA_INT_VAR_FACTOR); }
+    
+    IntVarFactor(IntDeclNode* var_, AstNodeKind kind_ = NODE_INT_VAR_FACTOR) : FactorNode(kind_), var(var_) { }
     void accept(AstVisitor& v);
     virtual void acceptRecursive(AstVisitor& v);
     
@@ -77,6 +180,10 @@ struct IntVarFactor : FactorNode
 
 struct InputIntNode : FactorNode
 {
+    static bool classof(const AstNode* node) { return node->kind == NODE_INPUT_INT; }
+    
+    InputIntNode() : FactorNode(NODE_INPUT_INT) { }
+    
     void accept(AstVisitor& v);
     virtual void acceptRecursive(AstVisitor& v);
 };
@@ -87,8 +194,10 @@ struct ThreeDimensionalListDecl;
 
 struct OneDimensionalListFactor : FactorNode
 {
+    static bool classof(const AstNode* node) { return node->kind == NODE_ONE_DIMENSIONAL_LIST_FACTOR; }
+    
     OneDimensionalListFactor(OneDimensionalListDecl* var_, ExpressionNode* index_)
-        : var(var_), index(index_) { }
+        : FactorNode(NODE_ONE_DIMENSIONAL_LIST_FACTOR), var(var_), index(index_) { }
     
     void accept(AstVisitor& v);
     virtual void acceptRecursive(AstVisitor& v);
@@ -99,8 +208,10 @@ struct OneDimensionalListFactor : FactorNode
 
 struct TwoDimensionalListFactor : FactorNode
 {
+    static bool classof(const AstNode* node) { return node->kind == NODE_TWO_DIMENSIONAL_LIST_FACTOR; }
+    
     TwoDimensionalListFactor(TwoDimensionalListDecl* var_, ExpressionNode* index0_, ExpressionNode* index1_)
-        : var(var_), index0(index0_), index1(index1_) { }
+        : FactorNode(NODE_TWO_DIMENSIONAL_LIST_FACTOR), var(var_), index0(index0_), index1(index1_) { }
     
     void accept(AstVisitor& v);
     virtual void acceptRecursive(AstVisitor& v);
@@ -112,8 +223,10 @@ struct TwoDimensionalListFactor : FactorNode
 
 struct ThreeDimensionalListFactor : FactorNode
 {
+    static bool classof(const AstNode* node) { return node->kind == NODE_THREE_DIMENSIONAL_LIST_FACTOR; }
+    
     ThreeDimensionalListFactor(ThreeDimensionalListDecl* var_, ExpressionNode* index0_, ExpressionNode* index1_, ExpressionNode* index2_)
-        : var(var_), index0(index0_), index1(index1_), index2(index2_) { }
+        : FactorNode(NODE_THREE_DIMENSIONAL_LIST_FACTOR), var(var_), index0(index0_), index1(index1_), index2(index2_) { }
     
     void accept(AstVisitor& v);
     virtual void acceptRecursive(AstVisitor& v);
@@ -126,32 +239,41 @@ struct ThreeDimensionalListFactor : FactorNode
 
 struct BinaryOpNode : ExpressionNode
 {
+    static bool classof(const AstNode* node) { return node->kind == NODE_BINARY_OP; }
+    
     BinaryOpNode(ExpressionNode* left_, TokenType op_, ExpressionNode* right_)
-        : left(left_), op(op_), right(right_) { }
+        : ExpressionNode(NODE_BINARY_OP), left(left_), op(op_), right(right_) { }
     
-    int tryEvaluate()
+    bool tryEvaluate(int& result)
+    {
+        return tryEvaluateOperators(this, result);
+    }
+    
+    // Returns false for ops that can't be evaluated and for division by zero
+    // (or INT_MIN / -1), which are left for the program to trap on at runtime
+    static bool evaluate(TokenType op, int a, int b, int& result)
     {
-        int a = left->tryEvaluate();
-        int b = right->tryEvaluate();
-        
         switch(op)
         {
-            case TOK_ADD: return a + b;
-            case TOK_SUB: return a - b;
-            case TOK_MUL: return a * b;
-            case TOK_DIV: return a / b;
-            case TOK_MOD: return a % b;
-            case TOK_EQ:  return a == b;
-            case TOK_NE:  return a != b;
-            case TOK_LT:  return a < b;
-            case TOK_GT:  return a > b;
-            case TOK_GE:  return a >= b;
-            case TOK_LE:  return a <= b;
+            case TOK_ADD: result = a + b; return true;
+            case TOK_SUB: result = a - b; return true;
+            case TOK_MUL: result = a * b; return true;
+            case TOK_DIV: if(!canDivide(a, b)) return false; result = a / b; return true;
+            case TOK_MOD: if(!canDivide(a, b)) return false; result = a % b; return true;
+            case TOK_EQ:  result = a == b; return true;
+            case TOK_NE:  result = a != b; return true;
+            case TOK_LT:  result = a < b; return true;
+            case TOK_GT:  result = a > b; return true;
+            case TOK_GE:  result = a >= b; return true;
+            case TOK_LE:  result = a <= b; return true;
             
-            default: break;
+            default: return false;
         }
-        
-        throw "Can't evaluate op";
+    }
+    
+    static bool canDivide(int a, int b)
+    {
+        return b != 0 && !(a == INT_MIN && b == -1);
     }
     
     void accept(AstVisitor& v);
@@ -164,17 +286,24 @@ struct BinaryOpNode : ExpressionNode
 
 struct UnaryOpNode : ExpressionNode
 {
-    UnaryOpNode(ExpressionNode* value_, TokenType op_) : value(value_), op(op_) { }
+    static bool classof(const AstNode* node) { return node->kind == NODE_UNARY_OP; }
+    
+    UnaryOpNode(ExpressionNode* value_, TokenType op_) : ExpressionNode(NODE_UNARY_OP), value(value_), op(op_) { }
     
-    int tryEvaluate()
+    bool tryEvaluate(int& result)
     {
-        if(op == TOK_ADD)
-            return value->tryEvaluate();
-        
-        if(op == TOK_SUB)
-            return -value->tryEvaluate();
-        
-        throw "Invalid unary op";
+        return tryEvaluateOperators(this, result);
+    }
+    
+    static bool evaluate(TokenType op, int a, int& result)
+    {
+        switch(op)
+        {
+            case TOK_ADD: result = a; return true;
+            case TOK_SUB: result = -a; return true;
+            
+            default: return false;
+        }
     }
     
     void accept(AstVisitor& v);
@@ -186,22 +315,54 @@ struct UnaryOpNode : ExpressionNode
 
 struct VarDeclNode : AstNode
 {
-    VarDeclNode(std::string name_, int line_, int col_)
-        : name(name_), line(line_), col(col_), definitionCount(0), eliminated(false) { }
+    static bool classof(const AstNode* node) { return kindInRange(node, NODE_INT_DECL, NODE_THREE_DIMENSIONAL_LIST_DECL); }
     
-    std::string name;
-    int line;
-    int col;
+    VarDeclNode(AstNodeKind kind_, Symbol* symbol_, int offset_)
+        : AstNode(kind_), symbol(symbol_), name(symbol_->name), offset(offset_), definitionCount(0), eliminated(false), varId(-1) { }
+    
+    Symbol* symbol;
+    const std::string& name;
+    int offset;         // Where it is in the source, or -1 if it was generated
     int definitionCount;
     bool eliminated;
+    
+    // Dense id assigned by the Ast when the variable is declared, which
+    // analyses index their per-variable tables by
+    int varId;
 };
 
 struct SsaIntLValueNode;
+struct StatementNode;
+struct PhiNode;
+
+// Sets of nodes are ordered by the dense ids the Ast gives them instead of by
+// address, so they're walked in the same order on every run and the output
+// doesn't depend on where the nodes happened to be allocated
+struct SsaValueOrder
+{
+    bool operator()(const SsaIntLValueNode* a, const SsaIntLValueNode* b) const;
+};
+
+struct StatementOrder
+{
+    bool operator()(const StatementNode* a, const StatementNode* b) const;
+};
+
+struct PhiNodeOrder
+{
+    bool operator()(const PhiNode* a, const PhiNode* b) const;
+};
+
+typedef std::set<SsaIntLValueNode*, SsaValueOrder> SsaValueSet;
+typedef std::set<StatementNode*, StatementOrder> StatementSet;
+typedef std::set<PhiNode*, PhiNodeOrder> PhiNodeSet;
 
 struct IntDeclNode : VarDeclNode
 {
-    IntDeclNode(std::string name_, int line_, int col_)
-        : VarDeclNode(name_, line_, col_) { }
+    static bool classof(const AstNode* node) { return node->kind == NODE_INT_DECL; }
+    
+    IntDeclNode(Symbol* symbol_, int offset_)
+        : VarDeclNode(NODE_INT_DECL, symbol_, offset_) { }
         
     void addSsaDefinition(SsaIntLValueNode* newDefinition)
     {
@@ -216,7 +377,9 @@ struct IntDeclNode : VarDeclNode
 
 struct PhiNode : FactorNode
 {
-    PhiNode(std::set<SsaIntLValueNode*> joinNodes_) : joinNodes(joinNodes_)
+    static bool classof(const AstNode* node) { return node->kind == NODE_PHI; }
+    
+    PhiNode(const SsaValueSet& joinNodes_) : FactorNode(NODE_PHI), joinNodes(joinNodes_), phiId(-1)
     {
         
     }
@@ -224,13 +387,18 @@ struct PhiNode : FactorNode
     void accept(AstVisitor& v);
     virtual void acceptRecursive(AstVisitor& v);
     
-    std::set<SsaIntLValueNode*> joinNodes;
+    SsaValueSet joinNodes;
+    
+    // Dense id assigned by the Ast when the phi node is created
+    int phiId;
 };
 
 struct OneDimensionalListDecl : VarDeclNode
 {
-    OneDimensionalListDecl(std::string name_, int line_, int col_, int totalElements_)
-        : VarDeclNode(name_, line_, col_),
+    static bool classof(const AstNode* node) { return node->kind == NODE_ONE_DIMENSIONAL_LIST_DECL; }
+    
+    OneDimensionalListDecl(Symbol* symbol_, int offset_, int totalElements_)
+        : VarDeclNode(NODE_ONE_DIMENSIONAL_LIST_DECL, symbol_, offset_),
         totalElements(totalElements_) { }
         
     int totalElements;
@@ -238,8 +406,10 @@ struct OneDimensionalListDecl : VarDeclNode
 
 struct TwoDimensionalListDecl : VarDeclNode
 {
-    TwoDimensionalListDecl(std::string name_, int line_, int col_, int totalElements0_, int totalElements1_)
-        : VarDeclNode(name_, line_, col_),
+    static bool classof(const AstNode* node) { return node->kind == NODE_TWO_DIMENSIONAL_LIST_DECL; }
+    
+    TwoDimensionalListDecl(Symbol* symbol_, int offset_, int totalElements0_, int totalElements1_)
+        : VarDeclNode(NODE_TWO_DIMENSIONAL_LIST_DECL, symbol_, offset_),
         totalElements0(totalElements0_), totalElements1(totalElements1_) { }
         
     int totalElements0;
@@ -248,8 +418,10 @@ struct TwoDimensionalListDecl : VarDeclNode
 
 struct ThreeDimensionalListDecl : VarDeclNode
 {
-    ThreeDimensionalListDecl(std::string name_, int line_, int col_, int totalElements0_, int totalElements1_, int totalElements2_)
-        : VarDeclNode(name_, line_, col_),
+    static bool classof(const AstNode* node) { return node->kind == NODE_THREE_DIMENSIONAL_LIST_DECL; }
+    
+    ThreeDimensionalListDecl(Symbol* symbol_, int offset_, int totalElements0_, int totalElements1_, int totalElements2_)
+        : VarDeclNode(NODE_THREE_DIMENSIONAL_LIST_DECL, symbol_, offset_),
         totalElements0(totalElements0_), totalElements1(totalElements1_), totalElements2(totalElements2_) { }
         
     int totalElements0;
@@ -257,20 +429,38 @@ struct ThreeDimensionalListDecl : VarDeclNode
     int totalElements2;
 };
 
+struct BasicBlockNode;
+
 struct StatementNode : AstNode
 {
-    StatementNode() : markedAsDead(false) { }
+    static bool classof(const AstNode* node) { return kindInRange(node, NODE_END, NODE_BASIC_BLOCK); }
+    
+    StatementNode(AstNodeKind kind_) : AstNode(kind_), markedAsDead(false), parentBlock(nullptr), statementId(-1), programOrder(-1) { }
     
     void markAsDead()
     {
         markedAsDead = true;
     }
     
+    bool inDeadCode();
+    
     bool markedAsDead;
+    BasicBlockNode* parentBlock;
+    
+    // Dense id assigned by the Ast when the statement is created. Unlike
+    // programOrder it never changes, so analyses can key side tables on it.
+    int statementId;
+    
+    // Position of the statement in program order, assigned by OptimizerWorklist
+    int programOrder;
 };
 
 struct EndNode : StatementNode
 {
+    static bool classof(const AstNode* node) { return node->kind == NODE_END; }
+    
+    EndNode() : StatementNode(NODE_END) { }
+    
     void accept(AstVisitor& v);
 };
 
@@ -278,12 +468,18 @@ class Ast;
 
 struct LValueNode : AstNode
 {
+    static bool classof(const AstNode* node) { return kindInRange(node, NODE_INT_LVALUE, NODE_THREE_DIMENSIONAL_LIST_LVALUE); }
+    
+    LValueNode(AstNodeKind kind_) : AstNode(kind_) { }
+    
     virtual FactorNode* getFactorNode(Ast& ast) = 0;
 };
 
 struct IntLValueNode : LValueNode
 {
-    IntLValueNode(IntDeclNode* var_) : var(var_) { }
+    static bool classof(const AstNode* node) { return kindInRange(node, NODE_INT_LVALUE, NODE_SSA_INT_LVALUE); }
+    
+    IntLValueNode(IntDeclNode* var_, AstNodeKind kind_ = NODE_INT_LVALUE) : LValueNode(kind_), var(var_) { }
     
     void accept(AstVisitor& v);
     virtual void acceptRecursive(AstVisitor& v);
@@ -298,13 +494,16 @@ struct LetStatementNode;
 
 struct SsaIntLValueNode : IntLValueNode
 {
+    static bool classof(const AstNode* node) { return node->kind == NODE_SSA_INT_LVALUE; }
+    
     SsaIntLValueNode(IntDeclNode* var_, BasicBlockNode* basicBlock_, LetStatementNode* definitionNode_)
-        : IntLValueNode(var_),
+        : IntLValueNode(var_, NODE_SSA_INT_LVALUE),
         basicBlock(basicBlock_),
         definitionNode(definitionNode_),
         refCount(0),
         hasConstantValue(false),
-        value(0)
+        value(0),
+        ssaId(-1)
         { }
         
     void setConstant(int val)
@@ -313,6 +512,16 @@ struct SsaIntLValueNode : IntLValueNode
         value = val;
     }
     
+    void addUser(StatementNode* statement)
+    {
+        users.insert(statement);
+    }
+    
+    void addPhiUse(PhiNode* phi)
+    {
+        phiUses.insert(phi);
+    }
+    
     virtual void acceptRecursive(AstVisitor& v);
     
     BasicBlockNode* basicBlock;
@@ -320,11 +529,37 @@ struct SsaIntLValueNode : IntLValueNode
     int refCount;
     bool hasConstantValue;
     int value;
+    
+    // Dense id assigned by the Ast when the value is created
+    int ssaId;
+    
+    // Def-use chains, built by DefUseBuilder. These may contain stale
+    // entries for uses that have since been folded away, but every live
+    // use is always present.
+    StatementSet users;
+    PhiNodeSet phiUses;
 };
 
+inline bool SsaValueOrder::operator()(const SsaIntLValueNode* a, const SsaIntLValueNode* b) const
+{
+    return a->ssaId < b->ssaId;
+}
+
+inline bool StatementOrder::operator()(const StatementNode* a, const StatementNode* b) const
+{
+    return a->statementId < b->statementId;
+}
+
+inline bool PhiNodeOrder::operator()(const PhiNode* a, const PhiNode* b) const
+{
+    return a->phiId < b->phiId;
+}
+
 struct SsaIntVarFactor : IntVarFactor
 {
-    SsaIntVarFactor(SsaIntLValueNode* node) : IntVarFactor(node->var), ssaLValue(node) { }
+    static bool classof(const AstNode* node) { return node->kind == NODE_SSA_INT_VAR_FACTOR; }
+    
+    SsaIntVarFactor(SsaIntLValueNode* node) : IntVarFactor(node->var, NODE_SSA_INT_VAR_FACTOR), ssaLValue(node) { }
     
     void accept(AstVisitor& v);
     virtual void acceptRecursive(AstVisitor& v);
@@ -334,8 +569,10 @@ struct SsaIntVarFactor : IntVarFactor
 
 struct OneDimensionalListLValueNode : LValueNode
 {
+    static bool classof(const AstNode* node) { return node->kind == NODE_ONE_DIMENSIONAL_LIST_LVALUE; }
+    
     OneDimensionalListLValueNode(OneDimensionalListDecl* var_, ExpressionNode* index_)
-        : var(var_), index(index_) { }
+        : LValueNode(NODE_ONE_DIMENSIONAL_LIST_LVALUE), var(var_), index(index_) { }
         
     void accept(AstVisitor& v);
     virtual void acceptRecursive(AstVisitor& v);
@@ -348,8 +585,10 @@ struct OneDimensionalListLValueNode : LValueNode
 
 struct TwoDimensionalListLValueNode : LValueNode
 {
+    static bool classof(const AstNode* node) { return node->kind == NODE_TWO_DIMENSIONAL_LIST_LVALUE; }
+    
     TwoDimensionalListLValueNode(TwoDimensionalListDecl* var_, ExpressionNode* index0_, ExpressionNode* index1_)
-        : var(var_), index0(index0_), index1(index1_) { }
+        : LValueNode(NODE_TWO_DIMENSIONAL_LIST_LVALUE), var(var_), index0(index0_), index1(index1_) { }
         
     void accept(AstVisitor& v);
     virtual void acceptRecursive(AstVisitor& v);
@@ -363,8 +602,10 @@ struct TwoDimensionalListLValueNode : LValueNode
 
 struct ThreeDimensionalListLValueNode : LValueNode
 {
+    static bool classof(const AstNode* node) { return node->kind == NODE_THREE_DIMENSIONAL_LIST_LVALUE; }
+    
     ThreeDimensionalListLValueNode(ThreeDimensionalListDecl* var_, ExpressionNode* index0_, ExpressionNode* index1_, ExpressionNode* index2_)
-        : var(var_), index0(index0_), index1(index1_), index2(index2_) { }
+        : LValueNode(NODE_THREE_DIMENSIONAL_LIST_LVALUE), var(var_), index0(index0_), index1(index1_), index2(index2_) { }
         
     void accept(AstVisitor& v);
     virtual void acceptRecursive(AstVisitor& v);
@@ -379,7 +620,9 @@ struct ThreeDimensionalListLValueNode : LValueNode
 
 struct LetStatementNode : StatementNode
 {
-    LetStatementNode(LValueNode* leftSide_, ExpressionNode* rightSide_) : leftSide(leftSide_), rightSide(rightSide_) { }
+    static bool classof(const AstNode* node) { return node->kind == NODE_LET; }
+    
+    LetStatementNode(LValueNode* leftSide_, ExpressionNode* rightSide_) : StatementNode(NODE_LET), leftSide(leftSide_), rightSide(rightSide_) { }
     
     void accept(AstVisitor& v);
     virtual void acceptRecursive(AstVisitor& v);
@@ -392,21 +635,25 @@ struct BasicBlockNode;
 
 struct GotoNode : StatementNode
 {
-    GotoNode(std::string labelName_, int line_, int col_)
-        : labelName(labelName_), line(line_), col(col_), targetBlock(nullptr) { }
+    static bool classof(const AstNode* node) { return node->kind == NODE_GOTO; }
+    
+    GotoNode(Symbol* label_, int offset_)
+        : StatementNode(NODE_GOTO), label(label_), labelName(label_->name), offset(offset_), targetBlock(nullptr) { }
     
     void accept(AstVisitor& v);
     virtual void acceptRecursive(AstVisitor& v);
     
-    std::string labelName;
-    int line;
-    int col;
+    Symbol* label;
+    const std::string& labelName;
+    int offset;         // Where it is in the source, or -1 if it was generated
     BasicBlockNode* targetBlock;
 };
 
 struct CodeBlockNode : StatementNode
 {
-    CodeBlockNode() : needCurlyBraces(true) { }
+    static bool classof(const AstNode* node) { return kindInRange(node, NODE_CODE_BLOCK, NODE_BASIC_BLOCK); }
+    
+    CodeBlockNode(AstNodeKind kind_ = NODE_CODE_BLOCK) : StatementNode(kind_), needCurlyBraces(true) { }
     
     void addStatement(StatementNode* node)
     {
@@ -425,9 +672,9 @@ struct CodeBlockNode : StatementNode
         
         auto lastStatement = *statements.rbegin();
         
-        if(dynamic_cast<GotoNode*>(lastStatement))
+        if(isa<GotoNode>(lastStatement))
             return true;
-        else if(CodeBlockNode* block = dynamic_cast<CodeBlockNode*>(lastStatement))
+        else if(CodeBlockNode* block = dyn_cast<CodeBlockNode>(lastStatement))
             return block->blockEndsInGoto();
         
         return false;
@@ -442,8 +689,10 @@ struct CodeBlockNode : StatementNode
 
 struct ForLoopNode : StatementNode
 {
+    static bool classof(const AstNode* node) { return node->kind == NODE_FOR; }
+    
     ForLoopNode(LValueNode* var_, ExpressionNode* lower, ExpressionNode* upper, ExpressionNode* inc, CodeBlockNode* body_)
-        : var(var_), lowerBound(lower), upperBound(upper), increment(inc), body(body_) { }
+        : StatementNode(NODE_FOR), var(var_), lowerBound(lower), upperBound(upper), increment(inc), body(body_) { }
     
     void accept(AstVisitor& v);
     
@@ -456,20 +705,24 @@ struct ForLoopNode : StatementNode
 
 struct LabelNode : StatementNode
 {
-    LabelNode(std::string name_, int line_, int col_)
-        : name(name_), line(line_), col(col_) { }
+    static bool classof(const AstNode* node) { return node->kind == NODE_LABEL; }
+    
+    LabelNode(Symbol* symbol_, int offset_)
+        : StatementNode(NODE_LABEL), symbol(symbol_), name(symbol_->name), offset(offset_) { }
     
     void accept(AstVisitor& v);
     
-    std::string name;
-    int line;
-    int col;
+    Symbol* symbol;
+    const std::string& name;
+    int offset;         // Where it is in the source, or -1 if it was generated
 };
 
 struct WhileLoopNode : StatementNode
 {
+    static bool classof(const AstNode* node) { return node->kind == NODE_WHILE; }
+    
     WhileLoopNode(ExpressionNode* condition_, CodeBlockNode* body_)
-        : condition(condition_), body(body_) { }
+        : StatementNode(NODE_WHILE), condition(condition_), body(body_) { }
     
     void accept(AstVisitor& v);
     
@@ -479,29 +732,17 @@ struct WhileLoopNode : StatementNode
 
 struct IfNode : StatementNode
 {
+    static bool classof(const AstNode* node) { return node->kind == NODE_IF; }
+    
     IfNode(ExpressionNode* condition_, StatementNode* body_)
-        : condition(condition_), body(body_) { }
+        : StatementNode(NODE_IF), condition(condition_), body(body_) { }
         
     void accept(AstVisitor& v);;
     virtual void acceptRecursive(AstVisitor& v);
     
-    void invertCondition()
-    {
-        auto node = dynamic_cast<BinaryOpNode*>(condition);
-        if(!node)
-            throw "Can't invert condition: not a binary of node";
-        
-        switch(node->op)
-        {
-            case TOK_LT: node->op = TOK_GE; break;
-            case TOK_LE: node->op = TOK_GT; break;
-            case TOK_EQ: node->op = TOK_NE; break;
-            case TOK_NE: node->op = TOK_EQ; break;
-            case TOK_GT: node->op = TOK_LE; break;
-            case TOK_GE: node->op = TOK_LT; break;
-            default: throw "Can't invert condition: un-invertable operator " + Token::getTokenName(node->op);
-        }
-    }
+    // A shared condition is replaced with a new node from ast rather than
+    // being changed
+    void invertCondition(Ast& ast);
     
     ExpressionNode* condition;
     StatementNode* body;
@@ -509,7 +750,9 @@ struct IfNode : StatementNode
 
 struct PrintNode : StatementNode
 {
-    PrintNode(ExpressionNode* value_) : value(value_) { }
+    static bool classof(const AstNode* node) { return node->kind == NODE_PRINT; }
+    
+    PrintNode(ExpressionNode* value_) : StatementNode(NODE_PRINT), value(value_) { }
     
     void accept(AstVisitor& v);
     void acceptRecursive(AstVisitor& v);;
@@ -519,7 +762,9 @@ struct PrintNode : StatementNode
 
 struct PromptNode : StatementNode
 {
-    PromptNode(std::string str_) : str(str_) { }
+    static bool classof(const AstNode* node) { return node->kind == NODE_PROMPT; }
+    
+    PromptNode(std::string str_) : StatementNode(NODE_PROMPT), str(str_) { }
     
     void accept(AstVisitor& v);
     void acceptRecursive(AstVisitor& v);
@@ -529,7 +774,9 @@ struct PromptNode : StatementNode
 
 struct InputNode : StatementNode
 {
-    InputNode(LValueNode* var_) : var(var_) { }
+    static bool classof(const AstNode* node) { return node->kind == NODE_INPUT; }
+    
+    InputNode(LValueNode* var_) : StatementNode(NODE_INPUT), var(var_) { }
     
     void accept(AstVisitor& v);
     void acceptRecursive(AstVisitor& v);
@@ -537,68 +784,11 @@ struct InputNode : StatementNode
     LValueNode* var;
 };
 
-struct VarDefSet
-{
-    VarDefSet() : changed(false) { }
-    
-    void replaceDefinition(SsaIntLValueNode* node)
-    {
-        defs[node->var].clear();
-        defs[node->var].insert(node);
-    }
-    
-    bool wasChanged()
-    {
-        bool oldChanged = changed;
-        changed = false;
-        return oldChanged;
-    }
-    
-    void clear()
-    {
-        defs.clear();
-    }
-    
-    void unionSet(VarDefSet& s)
-    {
-        for(auto d : s.defs)
-            defs[d.first].insert(d.second.begin(), d.second.end());
-    }
-    
-    bool operator==(const VarDefSet& s) const
-    {
-        return defs == s.defs;
-    }
-    
-    bool operator!=(const VarDefSet& s) const
-    {
-        return !(*this == s);
-    }
-    
-    std::set<SsaIntLValueNode*> getActiveDefsForVar(IntDeclNode* var)
-    {
-        return defs[var];
-    }
-    
-    void print(const char* label)
-    {
-        printf("%s set: ", label);
-        
-        for(auto var : defs)
-        {
-            printf("%s{%d} ", var.first->name.c_str(), (int)var.second.size());
-        }
-        
-        printf("\n");
-    }
-    
-    std::map<IntDeclNode*, std::set< SsaIntLValueNode* >> defs;
-    bool changed;
-};
-
 struct BasicBlockNode : CodeBlockNode
 {
-    BasicBlockNode()
+    static bool classof(const AstNode* node) { return node->kind == NODE_BASIC_BLOCK; }
+    
+    BasicBlockNode() : CodeBlockNode(NODE_BASIC_BLOCK)
     {
         needCurlyBraces = false;
         deleted = false;
@@ -610,26 +800,32 @@ struct BasicBlockNode : CodeBlockNode
         id = id_;
     }
     
+    void addStatement(StatementNode* node)
+    {
+        node->parentBlock = this;
+        statements.push_back(node);
+    }
+    
     void inheritSuccessorsFrom(BasicBlockNode* block)
     {
         for(auto b : block->successors)
-            successors.insert(b);
+            addSuccessor(b);
     }
     
     void inheritPredecessorsFrom(BasicBlockNode* block)
     {
         for(auto b : block->predecessors)
-            predecessors.insert(b);
+            addPredecessor(b);
     }
     
     void addSuccessor(BasicBlockNode* block)
     {
-        successors.insert(block);
+        addEdge(successors, block);
     }
     
     void addPredecessor(BasicBlockNode* block)
     {
-        predecessors.insert(block);
+        addEdge(predecessors, block);
     }
     
     std::vector<int> getSuccessorIds()
@@ -662,30 +858,31 @@ struct BasicBlockNode : CodeBlockNode
         return ids;
     }
     
-    void recalculateInSet()
-    {
-        varDefIn.clear();
-        
-        for(BasicBlockNode* predecessor : predecessors)
-            varDefIn.unionSet(predecessor->varDefOut);
-    }
-    
-    std::set<BasicBlockNode*> successors;
-    std::set<BasicBlockNode*> predecessors;
+    // Kept in the order the edges were added, without duplicates. A block
+    // only has a handful of edges, so a linear search beats a tree, and the
+    // order doesn't depend on where the blocks were allocated.
+    std::vector<BasicBlockNode*> successors;
+    std::vector<BasicBlockNode*> predecessors;
     int id;
     bool deleted;
     
     virtual void acceptRecursive(AstVisitor& v);
     
-    VarDefSet varDefIn;
-    VarDefSet varDefOut;
-    
     BasicBlockNode* directSuccessor;
+    
+private:
+    static void addEdge(std::vector<BasicBlockNode*>& edges, BasicBlockNode* block)
+    {
+        if(std::find(edges.begin(), edges.end(), block) == edges.end())
+            edges.push_back(block);
+    }
 };
 
 struct RemNode : StatementNode
 {
-    RemNode(std::string text_) : text(text_) { }
+    static bool classof(const AstNode* node) { return node->kind == NODE_REM; }
+    
+    RemNode(std::string text_) : StatementNode(NODE_REM), text(text_) { }
     
     void accept(AstVisitor& v);
     
@@ -695,254 +892,279 @@ struct RemNode : StatementNode
 class Ast
 {
 public:
+    Ast(SymbolTable& symbols_) : symbols(symbols_), totalNodes(0), totalStatements(0), totalPhiNodes(0) { }
+    
     void accept(AstVisitor& v);
     void accepVars(AstVisitor& v);
     
+    // Integers are interned by value, and operators whose operands are all
+    // shared (i.e. constant expressions) are hash-consed, so equal constants
+    // are the same node
     IntegerNode* newIntegerNode(int value)
     {
-        IntegerNode* newNode = new IntegerNode(value);
-        addNode(newNode);
-        return newNode;
+        IntegerNode*& node = integerNodes[value];
+        
+        if(!node)
+        {
+            node = createNode<IntegerNode>(value);
+            node->shared = true;
+        }
+        
+        return node;
     }
     
     IntVarFactor* addIntVarFactor(IntDeclNode* var)
     {
-        auto newNode = new IntVarFactor(var);
-        addNode(newNode);
+        auto newNode = createNode<IntVarFactor>(var);
         return newNode;
     }
     
     OneDimensionalListFactor* addOneDimensionalListFactor(OneDimensionalListDecl* var, ExpressionNode* index)
     {
-        auto newNode = new OneDimensionalListFactor(var, index);
-        addNode(newNode);
+        auto newNode = createNode<OneDimensionalListFactor>(var, index);
         return newNode;
     }
     
     TwoDimensionalListFactor* addTwoDimensionalListFactor(TwoDimensionalListDecl* var, ExpressionNode* index0, ExpressionNode* index1)
     {
-        auto newNode = new TwoDimensionalListFactor(var, index0, index1);
-        addNode(newNode);
+        auto newNode = createNode<TwoDimensionalListFactor>(var, index0, index1);
         return newNode;
     }
     
     ThreeDimensionalListFactor* addThreeDimensionalListFactor(ThreeDimensionalListDecl* var, ExpressionNode* index0, ExpressionNode* index1, ExpressionNode* index2)
     {
-        auto newNode = new ThreeDimensionalListFactor(var, index0, index1, index2);
-        addNode(newNode);
+        auto newNode = createNode<ThreeDimensionalListFactor>(var, index0, index1, index2);
         return newNode;
     }
     
     BinaryOpNode* newBinaryOpNode(ExpressionNode* left, TokenType op, ExpressionNode* right)
     {
-        BinaryOpNode* newNode = new BinaryOpNode(left, op, right);
-        addNode(newNode);
-        return newNode;
+        if(!left->shared || !right->shared)
+            return createNode<BinaryOpNode>(left, op, right);
+            
+        ExpressionNode*& node = sharedExpressions[SharedExpressionKey(NODE_BINARY_OP, op, left, right)];
+        
+        if(!node)
+        {
+            node = createNode<BinaryOpNode>(left, op, right);
+            node->shared = true;
+        }
+        
+        return cast<BinaryOpNode>(node);
     }
     
     UnaryOpNode* newUnaryOpNode(ExpressionNode* value, TokenType op)
     {
-        UnaryOpNode* newNode = new UnaryOpNode(value, op);
-        addNode(newNode);
-        return newNode;
+        if(!value->shared)
+            return createNode<UnaryOpNode>(value, op);
+            
+        ExpressionNode*& node = sharedExpressions[SharedExpressionKey(NODE_UNARY_OP, op, value, nullptr)];
+        
+        if(!node)
+        {
+            node = createNode<UnaryOpNode>(value, op);
+            node->shared = true;
+        }
+        
+        return cast<UnaryOpNode>(node);
     }
     
-    IntDeclNode* addIntegerVar(std::string name, int line, int col)
+    IntDeclNode* addIntegerVar(Symbol* name, int offset)
     {
-        IntDeclNode* newNode = new IntDeclNode(name, line, col);
-        vars.push_back(newNode);
+        IntDeclNode* newNode = arena.create<IntDeclNode>(name, offset);
+        addVar(newNode);
         return newNode;
     }
     
-    OneDimensionalListDecl* add1DListVar(std::string name, int line, int col, int totalElements)
+    OneDimensionalListDecl* add1DListVar(Symbol* name, int offset, int totalElements)
     {
-        OneDimensionalListDecl* newNode = new OneDimensionalListDecl(name, line, col, totalElements);
-        vars.push_back(newNode);
+        OneDimensionalListDecl* newNode = arena.create<OneDimensionalListDecl>(name, offset, totalElements);
+        addVar(newNode);
         return newNode;
     }
     
-    TwoDimensionalListDecl* add2DListVar(std::string name, int line, int col, int totalElements0, int totalElements1)
+    TwoDimensionalListDecl* add2DListVar(Symbol* name, int offset, int totalElements0, int totalElements1)
     {
-        TwoDimensionalListDecl* newNode = new TwoDimensionalListDecl(name, line, col, totalElements0, totalElements1);
-        vars.push_back(newNode);
+        TwoDimensionalListDecl* newNode = arena.create<TwoDimensionalListDecl>(name, offset, totalElements0, totalElements1);
+        addVar(newNode);
         return newNode;
     }
     
-    ThreeDimensionalListDecl* add3DListVar(std::string name, int line, int col, int totalElements0, int totalElements1, int totalElements2)
+    ThreeDimensionalListDecl* add3DListVar(Symbol* name, int offset, int totalElements0, int totalElements1, int totalElements2)
     {
-        ThreeDimensionalListDecl* newNode = new ThreeDimensionalListDecl(name, line, col, totalElements0, totalElements1, totalElements2);
-        vars.push_back(newNode);
+        ThreeDimensionalListDecl* newNode = arena.create<ThreeDimensionalListDecl>(name, offset, totalElements0, totalElements1, totalElements2);
+        addVar(newNode);
         return newNode;
     }
     
     IntLValueNode* addIntLValue(IntDeclNode* varDecl)
     {
-        IntLValueNode* newNode = new IntLValueNode(varDecl);
-        addNode(newNode);
+        IntLValueNode* newNode = createNode<IntLValueNode>(varDecl);
         return newNode;
     }
     
     OneDimensionalListLValueNode* addOneDimensionalListLValueNode(OneDimensionalListDecl* var, ExpressionNode* index)
     {
-        auto newNode = new OneDimensionalListLValueNode(var, index);
-        addNode(newNode);
+        auto newNode = createNode<OneDimensionalListLValueNode>(var, index);
         return newNode;
     }
     
     TwoDimensionalListLValueNode* addTwoDimensionalListLValueNode(TwoDimensionalListDecl* var, ExpressionNode* index0, ExpressionNode* index1)
     {
-        auto newNode = new TwoDimensionalListLValueNode(var, index0, index1);
-        addNode(newNode);
+        auto newNode = createNode<TwoDimensionalListLValueNode>(var, index0, index1);
         return newNode;
     }
     
     ThreeDimensionalListLValueNode* addThreeDimensionalListLValueNode(ThreeDimensionalListDecl* var, ExpressionNode* index0, ExpressionNode* index1, ExpressionNode* index2)
     {
-        auto newNode = new ThreeDimensionalListLValueNode(var, index0, index1, index2);
-        addNode(newNode);
+        auto newNode = createNode<ThreeDimensionalListLValueNode>(var, index0, index1, index2);
         return newNode;
     }
     
     LetStatementNode* addLetStatementNode(LValueNode* leftSide, ExpressionNode* rightSide)
     {
-        LetStatementNode* newNode = new LetStatementNode(leftSide, rightSide);
-        addNode(newNode);
+        LetStatementNode* newNode = createNode<LetStatementNode>(leftSide, rightSide);
         return newNode;
     }
     
     CodeBlockNode* addCodeBlockNode()
     {
-        CodeBlockNode* newNode = new CodeBlockNode;
-        addNode(newNode);
+        CodeBlockNode* newNode = createNode<CodeBlockNode>();
         return newNode;
     }
     
     ForLoopNode* addForLoopNode(LValueNode* var, ExpressionNode* lower, ExpressionNode* upper, ExpressionNode* inc, CodeBlockNode* body_)
     {
-        ForLoopNode* newNode = new ForLoopNode(var, lower, upper, inc, body_);
-        addNode(newNode);
+        ForLoopNode* newNode = createNode<ForLoopNode>(var, lower, upper, inc, body_);
         return newNode;
     }
     
-    LabelNode* addLabelNode(std::string name, int line, int col)
+    LabelNode* addLabelNode(Symbol* name, int offset)
     {
-        LabelNode* newNode = new LabelNode(name, line, col);
-        addNode(newNode);
+        LabelNode* newNode = createNode<LabelNode>(name, offset);
         
-        if(labelNames.count(name) != 0)
-            throw "Label " + name + " already exists";
+        LabelNode*& label = getSymbolEntry(labelsBySymbol, name);
+        
+        if(label != nullptr)
+            throw "Label " + name->name + " already exists";
             
-        labelNames.insert(name);
+        label = newNode;
+        labelNames.push_back(name);
         return newNode;
     }
     
-    GotoNode* addGotoNode(std::string targetLabel, int line, int col)
+    GotoNode* addGotoNode(Symbol* targetLabel, int offset)
     {
-        GotoNode* newNode = new GotoNode(targetLabel, line, col);
-        addNode(newNode);
+        GotoNode* newNode = createNode<GotoNode>(targetLabel, offset);
         return newNode;
     }
     
     WhileLoopNode* addWhileLoopNode(ExpressionNode* condition, CodeBlockNode* body_)
     {
-        auto newNode = new WhileLoopNode(condition, body_);
-        addNode(newNode);
+        auto newNode = createNode<WhileLoopNode>(condition, body_);
         return newNode;
     }
     
     IfNode* addIfNode(ExpressionNode* condition, StatementNode* body_)
     {
-        auto newNode = new IfNode(condition, body_);
-        addNode(newNode);
+        auto newNode = createNode<IfNode>(condition, body_);
         return newNode;
     }
     
     InputNode* addInputNode(LValueNode* var)
     {
-        auto newNode = new InputNode(var);
-        addNode(newNode);
+        auto newNode = createNode<InputNode>(var);
         return newNode;
     }
     
     PromptNode* addPromptNode(std::string str)
     {
-        auto newNode = new PromptNode(str);
-        addNode(newNode);
+        auto newNode = createNode<PromptNode>(str);
         return newNode;
     }
     
     PrintNode* addPrintNode(ExpressionNode* value)
     {
-        auto newNode = new PrintNode(value);
-        addNode(newNode);
+        auto newNode = createNode<PrintNode>(value);
         return newNode;
     }
     
     EndNode* addEndNode()
     {
-        auto newNode = new EndNode;
-        addNode(newNode);
+        auto newNode = createNode<EndNode>();
         return newNode;
     }
     
     BasicBlockNode* addBasicBlockNode()
     {
-        auto newNode = new BasicBlockNode;
-        addNode(newNode);
+        auto newNode = createNode<BasicBlockNode>();
         return newNode;
     }
     
     RemNode* addRemNode(std::string text)
     {
-        auto newNode = new RemNode(text);
-        addNode(newNode);
+        auto newNode = createNode<RemNode>(text);
         return newNode;
     }
     
     SsaIntLValueNode* addSsaIntLValueNode(IntLValueNode* node, BasicBlockNode* basicBlock, LetStatementNode* definitionNode)
     {
-        auto newNode = new SsaIntLValueNode(node->var, basicBlock, definitionNode);
+        auto newNode = createNode<SsaIntLValueNode>(node->var, basicBlock, definitionNode);
         node->var->addSsaDefinition(newNode);
-        addNode(newNode);
+        newNode->ssaId = ssaValues.size();
+        ssaValues.push_back(newNode);
         return newNode;
     }
     
+    SsaIntLValueNode* getSsaValue(int ssaId)
+    {
+        return ssaValues[ssaId];
+    }
+    
+    int getTotalSsaValues()
+    {
+        return ssaValues.size();
+    }
+    
+    int getTotalStatements()
+    {
+        return totalStatements;
+    }
+    
+    int getTotalVars()
+    {
+        return vars.size();
+    }
+    
     SsaIntVarFactor* addSsaIntVarFactorNode(SsaIntLValueNode* node)
     {
-        auto newNode = new SsaIntVarFactor(node);
-        addNode(newNode);
+        auto newNode = createNode<SsaIntVarFactor>(node);
         return newNode;
     }
     
     InputIntNode* addInputIntNode()
     {
-        auto newNode = new InputIntNode;
-        addNode(newNode);
+        auto newNode = createNode<InputIntNode>();
         return newNode;
     }
     
-    VarDeclNode* getVarByName(std::string name)
+    VarDeclNode* getVarByName(Symbol* name)
     {
-        for(VarDeclNode* var : vars)
-        {
-            if(var->name == name)
-                return var;
-        }
-        
-        return nullptr;
+        if(name == nullptr || name->id >= (int)varsBySymbol.size())
+            return nullptr;
+            
+        return varsBySymbol[name->id];
     }
     
     PolynomialNode* addPolynomialNode(Polynomial p)
     {
-        auto newNode = new PolynomialNode(p);
-        addNode(newNode);
+        auto newNode = createNode<PolynomialNode>(p);
         return newNode;
     }
     
-    PhiNode* addPhiNode(std::set<SsaIntLValueNode*> joinNodes)
+    PhiNode* addPhiNode(const SsaValueSet& joinNodes)
     {
-        auto newNode = new PhiNode(joinNodes);
-        addNode(newNode);
+        auto newNode = createNode<PhiNode>(joinNodes);
         return newNode;
     }
     
@@ -961,11 +1183,16 @@ public:
         return title;
     }
     
-    std::set<std::string>& getAllLabelNames()
+    std::vector<Symbol*>& getAllLabelNames()
     {
         return labelNames;
     }
     
+    SymbolTable& getSymbols()
+    {
+        return symbols;
+    }
+    
     CodeBlockNode* getBody()
     {
         return body;
@@ -973,36 +1200,109 @@ public:
     
     void splitIntoBasicBlocks();
     
+    void printMemoryStats()
+    {
+        arena.printStats();
+    }
+    
     ~Ast()
     {
-        std::cout << "Total nodes created in AST: " << nodes.size() << std::endl;
-        
-        for(AstNode* node : nodes)
-            delete node;
-        
-        for(VarDeclNode* node : vars)
-            delete node;
+        std::cout << "Total nodes created in AST: " << totalNodes << std::endl;
     }
     
     IntDeclNode* generateTempVar()
     {
         static int nextId = 0;
-        return addIntegerVar("temp" + std::to_string(nextId++) + "_", -1, -1);
+        return addIntegerVar(symbols.intern("temp" + std::to_string(nextId++) + "_"), -1);
     }
     
     void eliminateUnusedVars();
     void defaultInitializeVars();
     
 private:
-    void addNode(AstNode* node)
+    void addVar(VarDeclNode* var)
+    {
+        var->varId = vars.size();
+        vars.push_back(var);
+        
+        // Lookups find the first declaration of a name
+        VarDeclNode*& entry = getSymbolEntry(varsBySymbol, var->symbol);
+        if(entry == nullptr)
+            entry = var;
+    }
+    
+    template<typename T>
+    T*& getSymbolEntry(std::vector<T*>& table, Symbol* symbol)
     {
-        nodes.push_back(node);
+        if(symbol->id >= (int)table.size())
+            table.resize(symbols.getTotalSymbols(), nullptr);
+            
+        return table[symbol->id];
     }
     
-    std::vector<AstNode*> nodes;
+    struct SharedExpressionKey
+    {
+        SharedExpressionKey(AstNodeKind kind_, TokenType op_, ExpressionNode* left_, ExpressionNode* right_)
+            : kind(kind_), op(op_), left(left_), right(right_) { }
+            
+        bool operator==(const SharedExpressionKey& key) const
+        {
+            return kind == key.kind && op == key.op && left == key.left && right == key.right;
+        }
+        
+        AstNodeKind kind;
+        TokenType op;
+        ExpressionNode* left;
+        ExpressionNode* right;
+    };
+    
+    struct SharedExpressionKeyHash
+    {
+        size_t operator()(const SharedExpressionKey& key) const
+        {
+            size_t hash = std::hash<ExpressionNode*>()(key.left);
+            hash = hash * 31 + std::hash<ExpressionNode*>()(key.right);
+            return hash * 31 + key.kind * 64 + key.op;
+        }
+    };
+    
+    template<typename T, typename... Args>
+    T* createNode(Args&&... args)
+    {
+        ++totalNodes;
+        T* newNode = arena.create<T>(std::forward<Args>(args)...);
+        assignId(newNode);
+        return newNode;
+    }
+    
+    void assignId(StatementNode* node)
+    {
+        node->statementId = totalStatements++;
+    }
+    
+    void assignId(PhiNode* node)
+    {
+        node->phiId = totalPhiNodes++;
+    }
+    
+    void assignId(AstNode* node) { }
+    
+    SymbolTable& symbols;
+    Arena arena;
+    int totalNodes;
+    int totalStatements;
+    int totalPhiNodes;
+    std::vector<SsaIntLValueNode*> ssaValues;
     std::vector<VarDeclNode*> vars;
     CodeBlockNode* body;
     std::string title;
-    std::set<std::string> labelNames;
+    std::vector<Symbol*> labelNames;
+    
+    // Declarations indexed by symbol id
+    std::vector<VarDeclNode*> varsBySymbol;
+    std::vector<LabelNode*> labelsBySymbol;
+    
+    std::unordered_map<int, IntegerNode*> integerNodes;
+    std::unordered_map<SharedExpressionKey, ExpressionNode*, SharedExpressionKeyHash> sharedExpressions;
 };
 
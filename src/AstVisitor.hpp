@@ -5,10 +5,59 @@
 
 #include "Ast.hpp"
 
-struct AstVisitor
+// What AstVisitor and StaticVisitor share: the stack of nodes being walked,
+// through which a visit replaces the node it's looking at, and the state
+// AstWalker keeps in the visitor once a tree is too deep to recurse over
+struct VisitorState
 {
-    AstVisitor() : visitLetBefore(false) { }
+    VisitorState() : visitLetBefore(false), untrackedDepth(0) { }
     
+    void enterNode(AstNode* node) { nodeStack.push_back(node); }
+    void exitNode(AstNode* node) { nodeStack.pop_back(); }
+    AstNode* lastNode() { return nodeStack.back(); }
+    void replaceNode(AstNode* node) { nodeStack.back() = node; }
+    
+    // acceptRecursive recurses once per level of the tree, which is fine for
+    // any tree a person would write but not for a generated expression with
+    // thousands of terms. Below this depth the rest of a tree is walked by
+    // AstWalker instead, which doesn't use the call stack.
+    static const int MAX_RECURSION_DEPTH = 1000;
+    
+    bool isTooDeepToRecurse()
+    {
+        return (int)nodeStack.size() + untrackedDepth >= MAX_RECURSION_DEPTH;
+    }
+    
+    // A node AstWalker is in the middle of, and which of its children it's at
+    struct WalkFrame
+    {
+        AstNode* node;
+        int nextChild;
+    };
+    
+    std::vector<AstNode*> nodeStack;
+    std::vector<WalkFrame> walkStack;
+    bool visitLetBefore;
+    
+    // Levels recursed into without pushing a node (see
+    // StaticVisitor::replacesNodes)
+    int untrackedDepth;
+    
+    bool nodeReplaced(AstNode* node)
+    {
+        return nodeStack.size() != 0 && node != nodeStack[nodeStack.size() - 1];
+    }
+    
+protected:
+    ~VisitorState()
+    {
+        if(nodeStack.size() != 0)
+            fprintf(stderr, "Node stack has non-zero size\n");
+    }
+};
+
+struct AstVisitor : VisitorState
+{
     virtual void visit(AstNode* node) { }
     virtual void visit(StatementNode* node) { }
     virtual void visit(ExpressionNode* node) { }
@@ -45,22 +94,5 @@ struct AstVisitor
     
     virtual void visitVars(std::vector<VarDeclNode*>&) { }
     
-    virtual void enterNode(AstNode* node) { nodeStack.push_back(node); }
-    virtual void exitNode(AstNode* node) { nodeStack.pop_back(); }
-    virtual AstNode* lastNode() { return *nodeStack.rbegin(); }
-    virtual void replaceNode(AstNode* node) { nodeStack[nodeStack.size() - 1] = node; }
-    
-    std::vector<AstNode*> nodeStack;
-    bool visitLetBefore;
-    
-    bool nodeReplaced(AstNode* node)
-    {
-        return nodeStack.size() != 0 && node != nodeStack[nodeStack.size() - 1];
-    }
-    
-    virtual ~AstVisitor()
-    {
-        if(nodeStack.size() != 0)
-            fprintf(stderr, "Node stack has non-zero size\n");
-    }
+    virtual ~AstVisitor() { }
 };
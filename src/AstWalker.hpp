@@ -0,0 +1,414 @@
+#pragma once
+
+#include "Ast.hpp"
+#include "AstVisitor.hpp"
+
+// Walks a tree with an explicit stack kept in the visitor instead of the C++
+// call stack, so a left-deep chain of 100k additions is no deeper for it than
+// a single one. acceptRecursive hands a tree over to it once it has recursed
+// too deep (see VisitorState::MAX_RECURSION_DEPTH).
+//
+// The order of the visits, the enterNode/exitNode calls around each child and
+// the way a visitor replaces the node it's looking at are all the same as in
+// acceptRecursive: a node's children are those of the node as it was before
+// it was visited, and whatever is left on top of the node stack after a child
+// has been walked is stored back in its parent. A visitor may start another
+// walk from inside a visit; it runs on top of the stack of the one it was
+// started from.
+//
+// The visitor can be an AstVisitor or a StaticVisitor.
+class AstWalker
+{
+public:
+    template<typename Visitor>
+    static void walk(AstNode* root, Visitor& v)
+    {
+        std::vector<VisitorState::WalkFrame>& stack = v.walkStack;
+        size_t base = stack.size();
+        
+        visitBefore(root, v);
+        pushFrame(stack, root);
+        
+        while(stack.size() > base)
+        {
+            AstNode* node = stack.back().node;
+            AstNode* child = getChild(node, stack.back().nextChild);
+            
+            if(child)
+            {
+                v.enterNode(child);
+                visitBefore(child, v);
+                
+                // Most children are leaves, which don't need a frame
+                if(!isLeaf(child))
+                {
+                    pushFrame(stack, child);
+                    continue;
+                }
+            }
+            else
+            {
+                visitAfter(node, v);
+                stack.pop_back();
+                
+                if(stack.size() == base)
+                    break;
+                    
+                child = node;
+            }
+            
+            VisitorState::WalkFrame& parent = stack.back();
+            AstNode* newChild = v.lastNode();
+            if(newChild != child)
+                setChild(parent.node, parent.nextChild, newChild);
+                
+            v.exitNode(newChild);
+            ++parent.nextChild;
+        }
+    }
+    
+    // Whether the node never has any children to walk, and nothing to visit
+    // after them
+    static bool isLeaf(AstNode* node)
+    {
+        switch(node->kind)
+        {
+            case NODE_ONE_DIMENSIONAL_LIST_FACTOR:
+            case NODE_TWO_DIMENSIONAL_LIST_FACTOR:
+            case NODE_THREE_DIMENSIONAL_LIST_FACTOR:
+            case NODE_ONE_DIMENSIONAL_LIST_LVALUE:
+            case NODE_TWO_DIMENSIONAL_LIST_LVALUE:
+            case NODE_THREE_DIMENSIONAL_LIST_LVALUE:
+            case NODE_BINARY_OP:
+            case NODE_UNARY_OP:
+            case NODE_LET:
+            case NODE_IF:
+            case NODE_PRINT:
+            case NODE_INPUT:
+            case NODE_CODE_BLOCK:
+            case NODE_BASIC_BLOCK:
+                return false;
+                
+            default:
+                return true;
+        }
+    }
+    
+    // Returns the child the walk goes to next, starting from the given one,
+    // or nullptr if there are no more. Dead statements in a block are skipped
+    // over as they're reached, so child is moved past them.
+    static AstNode* getChild(AstNode* node, int& child)
+    {
+        switch(node->kind)
+        {
+            case NODE_ONE_DIMENSIONAL_LIST_FACTOR:
+                return child == 0 ? static_cast<OneDimensionalListFactor*>(node)->index : nullptr;
+                
+            case NODE_TWO_DIMENSIONAL_LIST_FACTOR:
+            {
+                TwoDimensionalListFactor* list = static_cast<TwoDimensionalListFactor*>(node);
+                return child == 0 ? list->index0 : (child == 1 ? list->index1 : nullptr);
+            }
+            
+            case NODE_THREE_DIMENSIONAL_LIST_FACTOR:
+            {
+                ThreeDimensionalListFactor* list = static_cast<ThreeDimensionalListFactor*>(node);
+                return child == 0 ? list->index0 : (child == 1 ? list->index1 : (child == 2 ? list->index2 : nullptr));
+            }
+            
+            case NODE_ONE_DIMENSIONAL_LIST_LVALUE:
+                return child == 0 ? static_cast<OneDimensionalListLValueNode*>(node)->index : nullptr;
+                
+            case NODE_TWO_DIMENSIONAL_LIST_LVALUE:
+            {
+                TwoDimensionalListLValueNode* list = static_cast<TwoDimensionalListLValueNode*>(node);
+                return child == 0 ? list->index0 : (child == 1 ? list->index1 : nullptr);
+            }
+            
+            case NODE_THREE_DIMENSIONAL_LIST_LVALUE:
+            {
+                ThreeDimensionalListLValueNode* list = static_cast<ThreeDimensionalListLValueNode*>(node);
+                return child == 0 ? list->index0 : (child == 1 ? list->index1 : (child == 2 ? list->index2 : nullptr));
+            }
+            
+            case NODE_BINARY_OP:
+            {
+                BinaryOpNode* op = static_cast<BinaryOpNode*>(node);
+                return child == 0 ? op->left : (child == 1 ? op->right : nullptr);
+            }
+            
+            case NODE_UNARY_OP:
+                return child == 0 ? static_cast<UnaryOpNode*>(node)->value : nullptr;
+                
+            case NODE_LET:
+            {
+                LetStatementNode* let = static_cast<LetStatementNode*>(node);
+                return child == 0 ? let->leftSide : (child == 1 ? (AstNode*)let->rightSide : nullptr);
+            }
+            
+            case NODE_IF:
+            {
+                IfNode* ifNode = static_cast<IfNode*>(node);
+                return child == 0 ? ifNode->condition : (child == 1 ? (AstNode*)ifNode->body : nullptr);
+            }
+            
+            case NODE_PRINT:
+                return child == 0 ? static_cast<PrintNode*>(node)->value : nullptr;
+                
+            case NODE_INPUT:
+                return child == 0 ? static_cast<InputNode*>(node)->var : nullptr;
+                
+            case NODE_CODE_BLOCK:
+            case NODE_BASIC_BLOCK:
+            {
+                std::vector<StatementNode*>& statements = static_cast<CodeBlockNode*>(node)->statements;
+                while(child < (int)statements.size() && statements[child]->markedAsDead)
+                    ++child;
+                    
+                return child < (int)statements.size() ? statements[child] : nullptr;
+            }
+            
+            default:
+                return nullptr;
+        }
+    }
+    
+    static void setChild(AstNode* node, int child, AstNode* value)
+    {
+        switch(node->kind)
+        {
+            case NODE_ONE_DIMENSIONAL_LIST_FACTOR:
+                static_cast<OneDimensionalListFactor*>(node)->index = cast<ExpressionNode>(value);
+                break;
+                
+            case NODE_TWO_DIMENSIONAL_LIST_FACTOR:
+            {
+                TwoDimensionalListFactor* list = static_cast<TwoDimensionalListFactor*>(node);
+                (child == 0 ? list->index0 : list->index1) = cast<ExpressionNode>(value);
+                break;
+            }
+            
+            case NODE_THREE_DIMENSIONAL_LIST_FACTOR:
+            {
+                ThreeDimensionalListFactor* list = static_cast<ThreeDimensionalListFactor*>(node);
+                (child == 0 ? list->index0 : (child == 1 ? list->index1 : list->index2)) = cast<ExpressionNode>(value);
+                break;
+            }
+            
+            case NODE_ONE_DIMENSIONAL_LIST_LVALUE:
+                static_cast<OneDimensionalListLValueNode*>(node)->index = cast<ExpressionNode>(value);
+                break;
+                
+            case NODE_TWO_DIMENSIONAL_LIST_LVALUE:
+            {
+                TwoDimensionalListLValueNode* list = static_cast<TwoDimensionalListLValueNode*>(node);
+                (child == 0 ? list->index0 : list->index1) = cast<ExpressionNode>(value);
+                break;
+            }
+            
+            case NODE_THREE_DIMENSIONAL_LIST_LVALUE:
+            {
+                ThreeDimensionalListLValueNode* list = static_cast<ThreeDimensionalListLValueNode*>(node);
+                (child == 0 ? list->index0 : (child == 1 ? list->index1 : list->index2)) = cast<ExpressionNode>(value);
+                break;
+            }
+            
+            case NODE_BINARY_OP:
+            {
+                BinaryOpNode* op = static_cast<BinaryOpNode*>(node);
+                (child == 0 ? op->left : op->right) = cast<ExpressionNode>(value);
+                break;
+            }
+            
+            case NODE_UNARY_OP:
+                static_cast<UnaryOpNode*>(node)->value = cast<ExpressionNode>(value);
+                break;
+                
+            case NODE_LET:
+            {
+                LetStatementNode* let = static_cast<LetStatementNode*>(node);
+                if(child == 0)
+                    let->leftSide = cast<LValueNode>(value);
+                else
+                    let->rightSide = cast<ExpressionNode>(value);
+                    
+                break;
+            }
+            
+            case NODE_IF:
+            {
+                IfNode* ifNode = static_cast<IfNode*>(node);
+                if(child == 0)
+                    ifNode->condition = cast<ExpressionNode>(value);
+                else
+                    ifNode->body = cast<StatementNode>(value);
+                    
+                break;
+            }
+            
+            case NODE_PRINT:
+                static_cast<PrintNode*>(node)->value = cast<ExpressionNode>(value);
+                break;
+                
+            case NODE_INPUT:
+                static_cast<InputNode*>(node)->var = cast<LValueNode>(value);
+                break;
+                
+            case NODE_CODE_BLOCK:
+            case NODE_BASIC_BLOCK:
+                static_cast<CodeBlockNode*>(node)->statements[child] = cast<StatementNode>(value);
+                break;
+                
+            default:
+                break;
+        }
+    }
+    
+    // Visits made before walking the node's children
+    template<typename Visitor>
+    static void visitBefore(AstNode* node, Visitor& v)
+    {
+        switch(node->kind)
+        {
+            case NODE_INTEGER:
+                v.visit(static_cast<IntegerNode*>(node));
+                break;
+                
+            case NODE_POLYNOMIAL:
+                v.visit(static_cast<PolynomialNode*>(node));
+                break;
+                
+            case NODE_INPUT_INT:
+                v.visit(static_cast<InputIntNode*>(node));
+                break;
+                
+            case NODE_ONE_DIMENSIONAL_LIST_FACTOR:
+                v.visit(static_cast<OneDimensionalListFactor*>(node));
+                break;
+                
+            case NODE_TWO_DIMENSIONAL_LIST_FACTOR:
+                v.visit(static_cast<TwoDimensionalListFactor*>(node));
+                break;
+                
+            case NODE_THREE_DIMENSIONAL_LIST_FACTOR:
+                v.visit(static_cast<ThreeDimensionalListFactor*>(node));
+                break;
+                
+            case NODE_PHI:
+                v.visit(static_cast<PhiNode*>(node));
+                break;
+                
+            case NODE_INT_VAR_FACTOR:
+                v.visit(static_cast<IntVarFactor*>(node));
+                break;
+                
+            case NODE_SSA_INT_VAR_FACTOR:
+                v.visit(static_cast<SsaIntVarFactor*>(node));
+                break;
+                
+            case NODE_INT_LVALUE:
+                v.visit(static_cast<IntLValueNode*>(node));
+                break;
+                
+            case NODE_SSA_INT_LVALUE:
+                v.visit(static_cast<SsaIntLValueNode*>(node));
+                break;
+                
+            case NODE_ONE_DIMENSIONAL_LIST_LVALUE:
+                v.visit(static_cast<OneDimensionalListLValueNode*>(node));
+                break;
+                
+            case NODE_TWO_DIMENSIONAL_LIST_LVALUE:
+                v.visit(static_cast<TwoDimensionalListLValueNode*>(node));
+                break;
+                
+            case NODE_THREE_DIMENSIONAL_LIST_LVALUE:
+                v.visit(static_cast<ThreeDimensionalListLValueNode*>(node));
+                break;
+                
+            case NODE_LET:
+                if(v.visitLetBefore)
+                {
+                    v.visit(static_cast<LetStatementNode*>(node));
+                    v.visit(static_cast<StatementNode*>(node));
+                }
+                
+                break;
+                
+            case NODE_GOTO:
+                v.visit(static_cast<GotoNode*>(node));
+                v.visit(static_cast<StatementNode*>(node));
+                break;
+                
+            case NODE_IF:
+                v.visit(static_cast<IfNode*>(node));
+                v.visit(static_cast<StatementNode*>(node));
+                break;
+                
+            case NODE_PRINT:
+                v.visit(static_cast<PrintNode*>(node));
+                v.visit(static_cast<StatementNode*>(node));
+                break;
+                
+            case NODE_PROMPT:
+                v.visit(static_cast<PromptNode*>(node));
+                v.visit(static_cast<StatementNode*>(node));
+                break;
+                
+            case NODE_INPUT:
+                v.visit(static_cast<InputNode*>(node));
+                v.visit(static_cast<StatementNode*>(node));
+                break;
+                
+            case NODE_CODE_BLOCK:
+                v.visit(static_cast<CodeBlockNode*>(node));
+                v.visit(static_cast<StatementNode*>(node));
+                break;
+                
+            case NODE_BASIC_BLOCK:
+                v.visit(static_cast<BasicBlockNode*>(node));
+                v.visit(static_cast<StatementNode*>(node));
+                break;
+                
+            default:
+                break;
+        }
+    }
+    
+    // Visits made after walking the node's children
+    template<typename Visitor>
+    static void visitAfter(AstNode* node, Visitor& v)
+    {
+        switch(node->kind)
+        {
+            case NODE_BINARY_OP:
+                v.visit(static_cast<BinaryOpNode*>(node));
+                break;
+                
+            case NODE_UNARY_OP:
+                v.visit(static_cast<UnaryOpNode*>(node));
+                break;
+                
+            case NODE_LET:
+                if(!v.visitLetBefore)
+                {
+                    v.visit(static_cast<LetStatementNode*>(node));
+                    v.visit(static_cast<StatementNode*>(node));
+                }
+                
+                break;
+                
+            default:
+                break;
+        }
+    }
+    
+private:
+    static void pushFrame(std::vector<VisitorState::WalkFrame>& stack, AstNode* node)
+    {
+        VisitorState::WalkFrame frame;
+        frame.node = node;
+        frame.nextChild = 0;
+        stack.push_back(frame);
+    }
+};
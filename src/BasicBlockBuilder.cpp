@@ -16,13 +16,15 @@ CodeBlockNode* BasicBlockBuilder::buildBasicBlocks()
 
 void BasicBlockBuilder::createBlocksForLabels()
 {
-    for(std::string name : ast.getAllLabelNames())
-        labelBlocks[name] = ast.addBasicBlockNode();
+    labelBlocks.resize(ast.getSymbols().getTotalSymbols(), nullptr);
+    
+    for(Symbol* name : ast.getAllLabelNames())
+        labelBlocks[name->id] = ast.addBasicBlockNode();
 }
 
 void BasicBlockBuilder::beginLabelBlock(LabelNode* node)
 {
-    insertBlockAfterCurrentBlock(labelBlocks[node->name]);
+    insertBlockAfterCurrentBlock(labelBlocks[node->symbol->id]);
 }
 
 void BasicBlockBuilder::splitCurrentBlock()
@@ -41,24 +43,24 @@ void BasicBlockBuilder::addCodeBlock(CodeBlockNode* node)
 {
     for(auto s : node->statements)
     {
-        if(CodeBlockNode* blockNode = dynamic_cast<CodeBlockNode*>(s))
+        if(CodeBlockNode* blockNode = dyn_cast<CodeBlockNode>(s))
         {
             addCodeBlock(blockNode);
             continue;
         }
         
-        if(LabelNode* labelNode = dynamic_cast<LabelNode*>(s))
+        if(LabelNode* labelNode = dyn_cast<LabelNode>(s))
         {
             beginLabelBlock(labelNode);
         }
         
         (*currentBlock)->addStatement(s);
         
-        if(GotoNode* gotoNode = dynamic_cast<GotoNode*>(s))
+        if(GotoNode* gotoNode = dyn_cast<GotoNode>(s))
         {
-            if(labelBlocks.count(gotoNode->labelName) == 0)
+            if(labelBlocks[gotoNode->label->id] == nullptr)
             {
-                throw CompileError("No such label: " + gotoNode->labelName, "Basic block partitioning", gotoNode->line, gotoNode->col);
+                throw CompileError("No such label: " + gotoNode->labelName, "Basic block partitioning", gotoNode->offset);
             }
             
             addGotoNodeTargetBlock(gotoNode);
@@ -67,15 +69,16 @@ void BasicBlockBuilder::addCodeBlock(CodeBlockNode* node)
             continue;
         }
         
-        if(IfNode* ifNode = dynamic_cast<IfNode*>(s))
+        if(IfNode* ifNode = dyn_cast<IfNode>(s))
         {
-            if(GotoNode* gotoNode = dynamic_cast<GotoNode*>(ifNode->body))
+            if(GotoNode* gotoNode = dyn_cast<GotoNode>(ifNode->body))
             {
+                gotoNode->parentBlock = *currentBlock;
                 addGotoNodeTargetBlock(gotoNode);
             }
             else
             {
-                throw CompileError("If contains statement other than goto", "Basic block partitioning", -1, -1);
+                throw CompileError("If contains statement other than goto", "Basic block partitioning", -1);
             }
             
             splitCurrentBlock();
@@ -86,7 +89,7 @@ void BasicBlockBuilder::addCodeBlock(CodeBlockNode* node)
 
 void BasicBlockBuilder::addGotoNodeTargetBlock(GotoNode* gotoNode)
 {
-    gotoNode->targetBlock = labelBlocks[gotoNode->labelName];
+    gotoNode->targetBlock = labelBlocks[gotoNode->label->id];
     gotoNode->targetBlock->addPredecessor(*currentBlock);
     (*currentBlock)->addSuccessor(gotoNode->targetBlock);
 }
@@ -1,7 +1,7 @@
 #pragma once
 
-#include <map>
 #include <list>
+#include <vector>
 
 #include "Ast.hpp"
 
@@ -24,7 +24,7 @@ private:
     CodeBlockNode* putBasicBlocksIntoCodeBlock();
     
     Ast& ast;
-    std::map<std::string, BasicBlockNode*> labelBlocks;
+    std::vector<BasicBlockNode*> labelBlocks;       // Indexed by symbol id
     std::list<BasicBlockNode*> blocks;
     std::list<BasicBlockNode*>::iterator currentBlock;
 };
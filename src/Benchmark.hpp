@@ -0,0 +1,29 @@
+#pragma once
+
+#include "File.hpp"
+#include "LexerBenchmark.hpp"
+#include "FoldingBenchmark.hpp"
+#include "TraversalBenchmark.hpp"
+#include "PassBenchmark.hpp"
+#include "DeepExpressionBenchmark.hpp"
+
+// Microbenchmarks for the compiler's front end, run on a real source file with
+// --bench. Each benchmark repeats its phase and reports the best run.
+// bench/emitted_code.sh times the C the compiler emits.
+class Benchmark
+{
+public:
+    Benchmark(SourceBuffer& source_) : source(source_) { }
+    
+    void run()
+    {
+        LexerBenchmark(source).run();
+        FoldingBenchmark(source).run();
+        TraversalBenchmark(source).run();
+        PassBenchmark(source).run();
+        DeepExpressionBenchmark(source).run();
+    }
+    
+private:
+    SourceBuffer& source;
+};
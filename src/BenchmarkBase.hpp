@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+
+#include "File.hpp"
+#include "Lexer.hpp"
+#include "TokenStream.hpp"
+#include "SymbolTable.hpp"
+#include "Parser.hpp"
+
+// What the benchmarks run by --bench share: the source file they run on, a
+// way to parse it and a timer that keeps the best of TOTAL_RUNS runs, so the
+// numbers are stable enough to compare between builds
+class BenchmarkBase
+{
+protected:
+    BenchmarkBase(SourceBuffer& source_) : source(source_) { }
+    
+    static const int TOTAL_RUNS = 20;
+    
+    // The Ast of a parsed source, along with everything it refers to
+    struct ParsedSource
+    {
+        ParsedSource(const char* begin, const char* end)
+            : lexer(begin, end, symbols),
+            tokens(lexer),
+            parser(tokens, symbols),
+            ast(parser.parse())
+            { }
+            
+        SymbolTable symbols;
+        Lexer lexer;
+        TokenStream tokens;
+        Parser parser;
+        Ast& ast;
+    };
+    
+    // Lexes and parses a source the way the compiler does
+    static std::unique_ptr<ParsedSource> parseSource(const char* begin, const char* end)
+    {
+        return std::unique_ptr<ParsedSource>(new ParsedSource(begin, end));
+    }
+    
+    std::unique_ptr<ParsedSource> parseSource()
+    {
+        return parseSource(source.begin(), source.end());
+    }
+    
+    template<typename Function>
+    double bestTime(Function f)
+    {
+        double best = 0;
+        
+        for(int i = 0; i < TOTAL_RUNS; ++i)
+        {
+            auto startTime = std::chrono::steady_clock::now();
+            f();
+            
+            double time = getMilliseconds(startTime, std::chrono::steady_clock::now());
+            if(i == 0 || time < best)
+                best = time;
+        }
+        
+        return best;
+    }
+    
+    static double getMilliseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+    {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+    
+    SourceBuffer& source;
+};
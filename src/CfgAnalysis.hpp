@@ -0,0 +1,55 @@
+#pragma once
+
+#include <memory>
+
+#include "Ast.hpp"
+#include "DominatorTree.hpp"
+#include "LoopNest.hpp"
+
+// Caches the analyses of the basic block graph, so that passes asking for the
+// dominator tree or the loops get the same results until the graph changes.
+// Results are built on first use after Ast::splitIntoBasicBlocks(), and
+// whatever changes the graph (adds or removes edges, kills blocks) has to call
+// invalidate(), after which references handed out earlier must not be used.
+class CfgAnalysis
+{
+public:
+    CfgAnalysis(CodeBlockNode* programBody_) : programBody(programBody_), totalBuilds(0) { }
+    
+    DominatorTree& getDominatorTree()
+    {
+        if(!dominatorTree)
+        {
+            dominatorTree.reset(new DominatorTree(programBody));
+            ++totalBuilds;
+        }
+        
+        return *dominatorTree;
+    }
+    
+    LoopNest& getLoopNest()
+    {
+        if(!loopNest)
+            loopNest.reset(new LoopNest(getDominatorTree()));
+            
+        return *loopNest;
+    }
+    
+    void invalidate()
+    {
+        dominatorTree.reset();
+        loopNest.reset();
+    }
+    
+    // How many times the dominator tree had to be built
+    int getTotalBuilds()
+    {
+        return totalBuilds;
+    }
+    
+private:
+    CodeBlockNode* programBody;
+    std::unique_ptr<DominatorTree> dominatorTree;
+    std::unique_ptr<LoopNest> loopNest;
+    int totalBuilds;
+};
@@ -0,0 +1,414 @@
+#pragma once
+
+#include <vector>
+#include <cstdio>
+
+#include "Ast.hpp"
+#include "IdSet.hpp"
+
+// Cleans up the basic block graph. Lowered loops and ifs leave lots of tiny
+// blocks behind, and the optimizer leaves more once it has killed ifs and
+// blocks, all of which every later pass has to look at and the code generator
+// turns into labels and gotos. In order:
+//
+//  - Jumps to a block that only holds labels and either a goto or nothing at
+//    all (falling through into a labelled block) are threaded to wherever that
+//    block leads.
+//  - Blocks that can no longer be reached are dropped.
+//  - Empty blocks without labels are dropped. Nothing can jump to them, so
+//    the block before them just falls through to the block after them.
+//  - A goto or an if whose goto leads to the block right after it is dropped.
+//    Conditions can't read input, so dropping an if has no side effects.
+//  - A block is merged into the block before it when that block falls
+//    straight through into it and nothing else leads to it.
+//  - Labels no goto refers to any more are dropped.
+//
+// Killed blocks and statements are dropped first, and the successors and
+// predecessors of the blocks are rebuilt from their statements afterwards, so
+// they're exact again even after the optimizer has killed ifs. Blocks are
+// renumbered in order.
+class CfgSimplifier
+{
+public:
+    CfgSimplifier(CodeBlockNode* programBody_, Ast& ast_)
+        : programBody(programBody_),
+        ast(ast_),
+        totalThreadedJumps(0),
+        totalRemovedJumps(0),
+        totalRemovedBlocks(0),
+        totalEmptyBlocks(0),
+        totalMergedBlocks(0),
+        totalRemovedLabels(0)
+        { }
+        
+    void simplify()
+    {
+        collectLiveBlocks();
+        threadJumps();
+        removeUnreachableBlocks();
+        removeEmptyBlocks();
+        removeJumpsToNextBlock();
+        
+        rebuildEdges();
+        mergeBlocks();
+        removeUnusedLabels();
+        
+        rebuildEdges();
+        programBody->statements.assign(blocks.begin(), blocks.end());
+    }
+    
+    void printStats()
+    {
+        printf("Jumps threaded: %d\n", totalThreadedJumps);
+        printf("Jumps to next block removed: %d\n", totalRemovedJumps);
+        printf("Unreachable blocks removed: %d\n", totalRemovedBlocks);
+        printf("Empty blocks removed: %d\n", totalEmptyBlocks);
+        printf("Blocks merged: %d\n", totalMergedBlocks);
+        printf("Unused labels removed: %d\n", totalRemovedLabels);
+    }
+    
+private:
+    void collectLiveBlocks()
+    {
+        blocks.clear();
+        
+        for(StatementNode* s : programBody->statements)
+        {
+            BasicBlockNode* block = cast<BasicBlockNode>(s);
+            if(block->markedAsDead)
+                continue;
+                
+            std::vector<StatementNode*>& statements = block->statements;
+            
+            int liveStatements = 0;
+            for(StatementNode* statement : statements)
+            {
+                if(!statement->markedAsDead)
+                    statements[liveStatements++] = statement;
+            }
+            
+            statements.resize(liveStatements);
+            
+            block->setId(blocks.size());
+            blocks.push_back(block);
+        }
+    }
+    
+    // The goto a statement ends its block with, if it's a goto or an if
+    GotoNode* getJump(StatementNode* node)
+    {
+        if(GotoNode* gotoNode = dyn_cast<GotoNode>(node))
+            return gotoNode;
+        else if(IfNode* ifNode = dyn_cast<IfNode>(node))
+            return cast<GotoNode>(ifNode->body);
+            
+        return nullptr;
+    }
+    
+    GotoNode* getJump(BasicBlockNode* block)
+    {
+        if(block->statements.size() == 0)
+            return nullptr;
+            
+        return getJump(block->statements.back());
+    }
+    
+    bool fallsThrough(BasicBlockNode* block)
+    {
+        return block->statements.size() == 0 || !isa<GotoNode>(block->statements.back());
+    }
+    
+    BasicBlockNode* getNextBlock(BasicBlockNode* block)
+    {
+        return block->id + 1 < (int)blocks.size() ? blocks[block->id + 1] : nullptr;
+    }
+    
+    LabelNode* getLabel(BasicBlockNode* block)
+    {
+        for(StatementNode* s : block->statements)
+        {
+            if(LabelNode* label = dyn_cast<LabelNode>(s))
+                return label;
+        }
+        
+        return nullptr;
+    }
+    
+    // Where control goes after entering a block that doesn't do anything, or
+    // nullptr if the block does something
+    BasicBlockNode* getForwardingTarget(BasicBlockNode* block)
+    {
+        for(StatementNode* s : block->statements)
+        {
+            if(isa<LabelNode>(s))
+                continue;
+                
+            if(GotoNode* gotoNode = dyn_cast<GotoNode>(s))
+                return gotoNode->targetBlock;
+                
+            return nullptr;
+        }
+        
+        return getNextBlock(block);
+    }
+    
+    // Follows a chain of blocks that don't do anything, stopping at the last
+    // one with a label (the others can't be jumped to) or when it goes around
+    // in a circle
+    BasicBlockNode* findFinalTarget(BasicBlockNode* target)
+    {
+        ++visitStamp;
+        
+        BasicBlockNode* finalTarget = target;
+        BasicBlockNode* block = target;
+        
+        while(block && visited[block->id] != visitStamp)
+        {
+            visited[block->id] = visitStamp;
+            
+            if(getLabel(block))
+                finalTarget = block;
+                
+            block = getForwardingTarget(block);
+        }
+        
+        return finalTarget;
+    }
+    
+    void threadJumps()
+    {
+        visited.assign(blocks.size(), 0);
+        visitStamp = 0;
+        
+        for(BasicBlockNode* block : blocks)
+        {
+            GotoNode* jump = getJump(block);
+            if(!jump)
+                continue;
+                
+            BasicBlockNode* finalTarget = findFinalTarget(jump->targetBlock);
+            if(finalTarget == jump->targetBlock)
+                continue;
+                
+            // A goto's label name can't be changed, so it's replaced
+            GotoNode* newJump = ast.addGotoNode(getLabel(finalTarget)->symbol, jump->offset);
+            newJump->targetBlock = finalTarget;
+            newJump->parentBlock = jump->parentBlock;
+            
+            if(IfNode* ifNode = dyn_cast<IfNode>(block->statements.back()))
+                ifNode->body = newJump;
+            else
+                block->statements.back() = newJump;
+                
+            ++totalThreadedJumps;
+        }
+    }
+    
+    // Runs after unreachable blocks are gone, which can leave a goto right
+    // before its target
+    void removeJumpsToNextBlock()
+    {
+        for(BasicBlockNode* block : blocks)
+        {
+            GotoNode* jump = getJump(block);
+            
+            if(jump && jump->targetBlock == getNextBlock(block))
+            {
+                block->statements.back()->markAsDead();
+                block->statements.pop_back();
+                ++totalRemovedJumps;
+            }
+        }
+    }
+    
+    void removeUnreachableBlocks()
+    {
+        std::vector<bool> reachable(blocks.size(), false);
+        std::vector<BasicBlockNode*> work;
+        
+        if(blocks.size() != 0)
+        {
+            reachable[0] = true;
+            work.push_back(blocks[0]);
+        }
+        
+        while(work.size() != 0)
+        {
+            BasicBlockNode* block = work.back();
+            work.pop_back();
+            
+            BasicBlockNode* successors[2] = { nullptr, nullptr };
+            
+            if(GotoNode* jump = getJump(block))
+                successors[0] = jump->targetBlock;
+                
+            if(fallsThrough(block))
+                successors[1] = getNextBlock(block);
+                
+            for(BasicBlockNode* successor : successors)
+            {
+                if(successor && !reachable[successor->id])
+                {
+                    reachable[successor->id] = true;
+                    work.push_back(successor);
+                }
+            }
+        }
+        
+        int totalReachable = 0;
+        for(BasicBlockNode* block : blocks)
+        {
+            if(reachable[block->id])
+                blocks[totalReachable++] = block;
+        }
+        
+        totalRemovedBlocks += blocks.size() - totalReachable;
+        blocks.resize(totalReachable);
+        renumberBlocks();
+    }
+    
+    void removeEmptyBlocks()
+    {
+        int totalLeft = 0;
+        
+        for(BasicBlockNode* block : blocks)
+        {
+            if(block->statements.size() != 0)
+            {
+                blocks[totalLeft++] = block;
+                continue;
+            }
+            
+            block->markAsDead();
+            ++totalEmptyBlocks;
+        }
+        
+        blocks.resize(totalLeft);
+        renumberBlocks();
+    }
+    
+    void mergeBlocks()
+    {
+        int totalLeft = 0;
+        
+        for(BasicBlockNode* block : blocks)
+        {
+            BasicBlockNode* previous = totalLeft != 0 ? blocks[totalLeft - 1] : nullptr;
+            
+            // Only the previous block leads here, and it can't go anywhere
+            // else, so nothing jumps to the labels of the block either
+            bool canMerge = previous
+                && previous->directSuccessor == block
+                && previous->successors.size() == 1
+                && block->predecessors.size() == 1;
+                
+            if(!canMerge)
+            {
+                blocks[totalLeft++] = block;
+                continue;
+            }
+            
+            for(StatementNode* s : block->statements)
+            {
+                if(isa<LabelNode>(s))
+                {
+                    ++totalRemovedLabels;
+                    continue;
+                }
+                
+                s->parentBlock = previous;
+                previous->statements.push_back(s);
+            }
+            
+            // The merged block's successors are now the previous block's
+            previous->successors = block->successors;
+            previous->directSuccessor = block->directSuccessor;
+            block->markAsDead();
+            ++totalMergedBlocks;
+        }
+        
+        blocks.resize(totalLeft);
+        renumberBlocks();
+    }
+    
+    void removeUnusedLabels()
+    {
+        IdSet usedLabels;
+        
+        for(BasicBlockNode* block : blocks)
+        {
+            if(GotoNode* jump = getJump(block))
+                usedLabels.insert(jump->label->id);
+        }
+        
+        for(BasicBlockNode* block : blocks)
+        {
+            std::vector<StatementNode*>& statements = block->statements;
+            
+            int totalLeft = 0;
+            for(StatementNode* s : statements)
+            {
+                LabelNode* label = dyn_cast<LabelNode>(s);
+                
+                if(label && !usedLabels.contains(label->symbol->id))
+                {
+                    ++totalRemovedLabels;
+                    continue;
+                }
+                
+                statements[totalLeft++] = s;
+            }
+            
+            statements.resize(totalLeft);
+        }
+    }
+    
+    void renumberBlocks()
+    {
+        for(int i = 0; i < (int)blocks.size(); ++i)
+            blocks[i]->setId(i);
+    }
+    
+    void rebuildEdges()
+    {
+        for(BasicBlockNode* block : blocks)
+        {
+            block->successors.clear();
+            block->predecessors.clear();
+            block->directSuccessor = nullptr;
+        }
+        
+        for(BasicBlockNode* block : blocks)
+        {
+            if(GotoNode* jump = getJump(block))
+                addEdge(block, jump->targetBlock);
+                
+            BasicBlockNode* next = getNextBlock(block);
+            
+            if(fallsThrough(block) && next)
+            {
+                addEdge(block, next);
+                block->directSuccessor = next;
+            }
+        }
+    }
+    
+    void addEdge(BasicBlockNode* from, BasicBlockNode* to)
+    {
+        from->addSuccessor(to);
+        to->addPredecessor(from);
+    }
+    
+    CodeBlockNode* programBody;
+    Ast& ast;
+    std::vector<BasicBlockNode*> blocks;
+    std::vector<int> visited;
+    int visitStamp;
+    
+    int totalThreadedJumps;
+    int totalRemovedJumps;
+    int totalRemovedBlocks;
+    int totalEmptyBlocks;
+    int totalMergedBlocks;
+    int totalRemovedLabels;
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#define CHAR_SCANNER_SIMD
+#endif
+
+// Finds the end of runs of characters for the lexer, a whole block of
+// characters at a time where SSE2 (or AVX2, if the compiler targets it) is
+// available. Anything shorter than a block is scanned one character at a
+// time, so nothing is ever read past the end of the buffer.
+//
+// Character classes are plain ASCII, which is what isalpha and friends give
+// us in the "C" locale the compiler runs in.
+class CharScanner
+{
+public:
+    static const char* skipWhitespace(const char* p, const char* end)
+    {
+#ifdef CHAR_SCANNER_SIMD
+        while(end - p >= BLOCK_SIZE)
+        {
+            Block block = load(p);
+            unsigned int mask = ~getMask(orBlocks(orBlocks(equal(block, ' '), equal(block, '\t')), orBlocks(equal(block, '\n'), equal(block, '\r')))) & FULL_MASK;
+            
+            if(mask != 0)
+                return p + __builtin_ctz(mask);
+                
+            p += BLOCK_SIZE;
+        }
+#endif
+
+        while(p < end && isWhitespace(*p))
+            ++p;
+            
+        return p;
+    }
+    
+    static const char* skipIdentifierChars(const char* p, const char* end)
+    {
+#ifdef CHAR_SCANNER_SIMD
+        while(end - p >= BLOCK_SIZE)
+        {
+            Block block = load(p);
+            Block lower = orBlocks(block, set(0x20));
+            Block identifierChars = orBlocks(orBlocks(inRange(lower, 'a', 'z'), inRange(block, '0', '9')), equal(block, '_'));
+            unsigned int mask = ~getMask(identifierChars) & FULL_MASK;
+            
+            if(mask != 0)
+                return p + __builtin_ctz(mask);
+                
+            p += BLOCK_SIZE;
+        }
+#endif
+
+        while(p < end && isIdentifierChar(*p))
+            ++p;
+            
+        return p;
+    }
+    
+    static const char* skipDigits(const char* p, const char* end)
+    {
+#ifdef CHAR_SCANNER_SIMD
+        while(end - p >= BLOCK_SIZE)
+        {
+            unsigned int mask = ~getMask(inRange(load(p), '0', '9')) & FULL_MASK;
+            
+            if(mask != 0)
+                return p + __builtin_ctz(mask);
+                
+            p += BLOCK_SIZE;
+        }
+#endif
+
+        while(p < end && isDigit(*p))
+            ++p;
+            
+        return p;
+    }
+    
+    // The end of the line (or of the buffer)
+    static const char* findLineEnd(const char* p, const char* end)
+    {
+        const char* newline = (const char*)memchr(p, '\n', end - p);
+        return newline ? newline : end;
+    }
+    
+    // The closing '"' of a string, or the end of the line if there isn't one
+    static const char* findStringEnd(const char* p, const char* end)
+    {
+#ifdef CHAR_SCANNER_SIMD
+        while(end - p >= BLOCK_SIZE)
+        {
+            Block block = load(p);
+            unsigned int mask = getMask(orBlocks(equal(block, '"'), equal(block, '\n')));
+            
+            if(mask != 0)
+                return p + __builtin_ctz(mask);
+                
+            p += BLOCK_SIZE;
+        }
+#endif
+
+        while(p < end && *p != '"' && *p != '\n')
+            ++p;
+            
+        return p;
+    }
+    
+    static bool isWhitespace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+    
+    static bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+    
+    static bool isAlpha(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+    
+    static bool isIdentifierChar(char c)
+    {
+        return isAlpha(c) || isDigit(c) || c == '_';
+    }
+    
+private:
+#if defined(__AVX2__)
+    typedef __m256i Block;
+    static const int BLOCK_SIZE = 32;
+    static const unsigned int FULL_MASK = 0xFFFFFFFF;
+    
+    static Block load(const char* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    static Block set(char c) { return _mm256_set1_epi8(c); }
+    static Block equal(Block block, char c) { return _mm256_cmpeq_epi8(block, set(c)); }
+    static Block greater(Block a, Block b) { return _mm256_cmpgt_epi8(a, b); }
+    static Block orBlocks(Block a, Block b) { return _mm256_or_si256(a, b); }
+    static Block andBlocks(Block a, Block b) { return _mm256_and_si256(a, b); }
+    static unsigned int getMask(Block block) { return (unsigned int)_mm256_movemask_epi8(block); }
+#elif defined(__SSE2__)
+    typedef __m128i Block;
+    static const int BLOCK_SIZE = 16;
+    static const unsigned int FULL_MASK = 0xFFFF;
+    
+    static Block load(const char* p) { return _mm_loadu_si128((const __m128i*)p); }
+    static Block set(char c) { return _mm_set1_epi8(c); }
+    static Block equal(Block block, char c) { return _mm_cmpeq_epi8(block, set(c)); }
+    static Block greater(Block a, Block b) { return _mm_cmpgt_epi8(a, b); }
+    static Block orBlocks(Block a, Block b) { return _mm_or_si128(a, b); }
+    static Block andBlocks(Block a, Block b) { return _mm_and_si128(a, b); }
+    static unsigned int getMask(Block block) { return (unsigned int)_mm_movemask_epi8(block); }
+#endif
+
+#ifdef CHAR_SCANNER_SIMD
+    // Bytes are compared as signed, so anything outside of ASCII is never in
+    // range
+    static Block inRange(Block block, char low, char high)
+    {
+        return andBlocks(greater(block, set(low - 1)), greater(set(high + 1), block));
+    }
+#endif
+};
@@ -4,10 +4,17 @@
 
 #include "AstVisitor.hpp"
 #include "Utils.hpp"
+#include "ControlFlowStructurizer.hpp"
 
 struct CodeGenerator : AstVisitor
 {
-    CodeGenerator() : currentIndent(0)
+    // Without structureControlFlow_, the blocks are emitted one after the
+    // other with the labels and gotos they were lowered to
+    CodeGenerator(bool structureControlFlow_ = true)
+        : currentIndent(0),
+        needsReadInt(false),
+        structureControlFlow(structureControlFlow_),
+        structurizer(nullptr)
     {
         
     }
@@ -19,21 +26,21 @@ struct CodeGenerator : AstVisitor
             if(var->eliminated)
                 continue;
             
-            if(auto intVar = dynamic_cast<IntDeclNode*>(var))
+            if(auto intVar = dyn_cast<IntDeclNode>(var))
             {
                 addLine("int " + intVar->name + ";");
             }
-            else if(auto listVar = dynamic_cast<OneDimensionalListDecl*>(var))
+            else if(auto listVar = dyn_cast<OneDimensionalListDecl>(var))
             {
                 addLine("int " + listVar->name + "[" + std::to_string(listVar->totalElements) + "];");
             }
-            else if(auto listVar = dynamic_cast<TwoDimensionalListDecl*>(var))
+            else if(auto listVar = dyn_cast<TwoDimensionalListDecl>(var))
             {
                 addLine("int " + listVar->name +
                     "[" + std::to_string(listVar->totalElements0) + "]" + 
                     "[" + std::to_string(listVar->totalElements1) + "];");
             }
-            else if(auto listVar = dynamic_cast<ThreeDimensionalListDecl*>(var))
+            else if(auto listVar = dyn_cast<ThreeDimensionalListDecl>(var))
             {
                 addLine("int " + listVar->name +
                     "[" + std::to_string(listVar->totalElements0) + "]" +
@@ -70,7 +77,13 @@ struct CodeGenerator : AstVisitor
         addReadIntPrototype();
         
         addLine("int main()");
-        ast.accept(*this);
+        
+        CodeBlockNode* body = ast.getBody();
+        
+        if(structureControlFlow && body->statements.size() != 0 && isa<BasicBlockNode>(body->statements[0]))
+            genStructuredBody(body);
+        else
+            ast.accept(*this);
         
         if(needsReadInt)
             addReadIntDef();
@@ -133,34 +146,17 @@ struct CodeGenerator : AstVisitor
     
     void visit(OneDimensionalListFactor* node)
     {
-        node->index->accept(*this);
-        
-        std::string index = pop();
-        push(node->var->name + "[" + index + "]");
+        push(genExpression(node));
     }
     
     void visit(TwoDimensionalListFactor* node)
     {
-        node->index1->accept(*this);
-        node->index0->accept(*this);
-        
-        std::string index0 = pop();
-        std::string index1 = pop();
-        
-        push(node->var->name + "[" + index0 + "][" + index1 + "]");
+        push(genExpression(node));
     }
     
     void visit(ThreeDimensionalListFactor* node)
     {
-        node->index2->accept(*this);
-        node->index1->accept(*this);
-        node->index0->accept(*this);
-        
-        std::string index0 = pop();
-        std::string index1 = pop();
-        std::string index2 = pop();
-        
-        push(node->var->name + "[" + index0 + "][" + index1 + "][" + index2 + "]");
+        push(genExpression(node));
     }
     
     void visit(IntLValueNode* node)
@@ -207,26 +203,106 @@ struct CodeGenerator : AstVisitor
     
     void visit(BinaryOpNode* node)
     {
-        node->left->accept(*this);
-        node->right->accept(*this);
-        
-        std::string op = Token::getTokenName(node->op);
-        
-        std::string right = pop();
-        std::string left = pop();
-        
-        push("(" + left + " " + op + " " + right + ")");
+        push(genExpression(node));
     }
     
     void visit(UnaryOpNode* node)
     {
-        node->value->accept(*this);
-        push(Token::getTokenName(node->op) + "(" + pop() + ")");
+        push(genExpression(node));
+    }
+    
+    // Writes the code for an expression from left to right into one string,
+    // with a stack of its own instead of recursing. Building it bottom up
+    // would recurse once per operator and copy the code of a chain of 100k
+    // additions once per addition. The work stack holds the subtrees and
+    // pieces of text that are still to be written, last one first.
+    std::string genExpression(ExpressionNode* root)
+    {
+        std::string code;
+        std::vector<ExpressionPiece> work;
+        work.push_back(ExpressionPiece(root));
+        
+        while(work.size() != 0)
+        {
+            ExpressionPiece piece = work.back();
+            work.pop_back();
+            
+            ExpressionNode* node = piece.node;
+            
+            if(!node)
+            {
+                code += piece.text;
+                continue;
+            }
+            
+            switch(node->kind)
+            {
+                case NODE_BINARY_OP:
+                {
+                    BinaryOpNode* op = static_cast<BinaryOpNode*>(node);
+                    code += "(";
+                    work.push_back(ExpressionPiece(")"));
+                    work.push_back(ExpressionPiece(op->right));
+                    work.push_back(ExpressionPiece(" " + Token::getTokenName(op->op) + " "));
+                    work.push_back(ExpressionPiece(op->left));
+                    break;
+                }
+                
+                case NODE_UNARY_OP:
+                {
+                    UnaryOpNode* op = static_cast<UnaryOpNode*>(node);
+                    code += Token::getTokenName(op->op) + "(";
+                    work.push_back(ExpressionPiece(")"));
+                    work.push_back(ExpressionPiece(op->value));
+                    break;
+                }
+                
+                case NODE_ONE_DIMENSIONAL_LIST_FACTOR:
+                {
+                    OneDimensionalListFactor* list = static_cast<OneDimensionalListFactor*>(node);
+                    code += list->var->name + "[";
+                    work.push_back(ExpressionPiece("]"));
+                    work.push_back(ExpressionPiece(list->index));
+                    break;
+                }
+                
+                case NODE_TWO_DIMENSIONAL_LIST_FACTOR:
+                {
+                    TwoDimensionalListFactor* list = static_cast<TwoDimensionalListFactor*>(node);
+                    code += list->var->name + "[";
+                    work.push_back(ExpressionPiece("]"));
+                    work.push_back(ExpressionPiece(list->index1));
+                    work.push_back(ExpressionPiece("]["));
+                    work.push_back(ExpressionPiece(list->index0));
+                    break;
+                }
+                
+                case NODE_THREE_DIMENSIONAL_LIST_FACTOR:
+                {
+                    ThreeDimensionalListFactor* list = static_cast<ThreeDimensionalListFactor*>(node);
+                    code += list->var->name + "[";
+                    work.push_back(ExpressionPiece("]"));
+                    work.push_back(ExpressionPiece(list->index2));
+                    work.push_back(ExpressionPiece("]["));
+                    work.push_back(ExpressionPiece(list->index1));
+                    work.push_back(ExpressionPiece("]["));
+                    work.push_back(ExpressionPiece(list->index0));
+                    break;
+                }
+                
+                default:
+                    node->accept(*this);
+                    code += pop();
+                    break;
+            }
+        }
+        
+        return code;
     }
     
     void visit(LetStatementNode* node)
     {
-        if(dynamic_cast<PhiNode*>(node->rightSide))
+        if(isa<PhiNode>(node->rightSide))
             return;
         
         node->rightSide->accept(*this);
@@ -240,7 +316,7 @@ struct CodeGenerator : AstVisitor
     
     void visit(CodeBlockNode* node)
     {
-        if(BasicBlockNode* basicBlockNode = dynamic_cast<BasicBlockNode*>(node))
+        if(BasicBlockNode* basicBlockNode = dyn_cast<BasicBlockNode>(node))
         {
             addBasicBlockCommentLine(basicBlockNode);
         }
@@ -280,6 +356,184 @@ struct CodeGenerator : AstVisitor
         addLine("// * block " + std::to_string(node->id) + " pred " + pred + " succ " + succ);
     }
     
+    void genStructuredBody(CodeBlockNode* body)
+    {
+        ControlFlowStructurizer bodyStructurizer(body);
+        bodyStructurizer.structure();
+        structurizer = &bodyStructurizer;
+        
+        addLine("{");
+        ++currentIndent;
+        
+        genRegions(structurizer->getRoot());
+        
+        --currentIndent;
+        addLine("}");
+        addLine("");
+        
+        structurizer = nullptr;
+    }
+    
+    void genRegions(const std::vector<int>& sequence)
+    {
+        for(int region : sequence)
+        {
+            const ControlFlowStructurizer::Region& r = structurizer->getRegion(region);
+            
+            if(r.kind == ControlFlowStructurizer::REGION_BLOCK)
+                genBlock(r);
+            else if(r.kind == ControlFlowStructurizer::REGION_LOOP)
+                genLoop(r);
+            else
+                genIf(r);
+        }
+    }
+    
+    void genBlock(const ControlFlowStructurizer::Region& region)
+    {
+        BasicBlockNode* block = structurizer->getBlock(region.block);
+        addBasicBlockCommentLine(block);
+        
+        int labelsBegin = output.size();
+        
+        if(!region.labelsHoisted)
+            genUsedLabels(block);
+            
+        int labelsEnd = output.size();
+        
+        for(StatementNode* s : block->statements)
+        {
+            if(s->markedAsDead || isa<LabelNode>(s))
+                continue;
+                
+            if(s == block->statements.back() && (isa<GotoNode>(s) || isa<IfNode>(s)))
+                genJump(s, structurizer->getJumpAction(region.block));
+            else
+                s->accept(*this);
+        }
+        
+        // A label has to be followed by a statement, and the block may be
+        // last before a closing brace
+        if(labelsEnd != labelsBegin && (int)output.size() == labelsEnd)
+            addLine(";");
+    }
+    
+    void genUsedLabels(BasicBlockNode* block)
+    {
+        for(StatementNode* s : block->statements)
+        {
+            LabelNode* label = dyn_cast<LabelNode>(s);
+            
+            if(label && structurizer->isLabelUsed(label))
+                label->accept(*this);
+        }
+    }
+    
+    void genJump(StatementNode* node, ControlFlowStructurizer::JumpAction action)
+    {
+        if(action == ControlFlowStructurizer::JUMP_GOTO)
+        {
+            node->accept(*this);
+            return;
+        }
+        
+        if(action == ControlFlowStructurizer::JUMP_IMPLICIT)
+            return;
+            
+        std::string jump = action == ControlFlowStructurizer::JUMP_BREAK ? "break;" : "continue;";
+        
+        if(IfNode* ifNode = dyn_cast<IfNode>(node))
+        {
+            addLine("if(" + genCondition(ifNode) + ")");
+            
+            ++currentIndent;
+            addLine(jump);
+            --currentIndent;
+            
+            addLine("");
+        }
+        else
+        {
+            addLine(jump);
+        }
+    }
+    
+    void genLoop(const ControlFlowStructurizer::Region& region)
+    {
+        BasicBlockNode* first = structurizer->getBlock(region.block);
+        
+        switch(region.form)
+        {
+            case ControlFlowStructurizer::LOOP_DO_WHILE:
+                genUsedLabels(first);
+                addLine("do");
+                genBracedRegions(region.body, "} while(" + genCondition(structurizer->getIf(region.testBlock)) + ");");
+                break;
+                
+            case ControlFlowStructurizer::LOOP_WHILE:
+            case ControlFlowStructurizer::LOOP_ROTATED_WHILE:
+            {
+                BasicBlockNode* test = structurizer->getBlock(region.testBlock);
+                std::string condition = genCondition(structurizer->getIf(region.testBlock));
+                
+                addBasicBlockCommentLine(test);
+                genUsedLabels(test);
+                
+                // A lowered while loop jumps back while the condition holds,
+                // a loop tested at the top jumps out once it does
+                if(region.form == ControlFlowStructurizer::LOOP_WHILE)
+                    condition = "!" + condition;
+                    
+                addLine("while(" + condition + ")");
+                genBracedRegions(region.body, "}");
+                break;
+            }
+                
+            case ControlFlowStructurizer::LOOP_FOREVER:
+                genUsedLabels(first);
+                addLine("for(;;)");
+                genBracedRegions(region.body, "}");
+                break;
+        }
+    }
+    
+    void genIf(const ControlFlowStructurizer::Region& region)
+    {
+        addLine("if(!" + genCondition(structurizer->getIf(region.testBlock)) + ")");
+        
+        if(region.elseBody.size() == 0)
+        {
+            genBracedRegions(region.body, "}");
+            return;
+        }
+        
+        genBracedRegions(region.body, "}", false);
+        addLine("else");
+        genBracedRegions(region.elseBody, "}");
+    }
+    
+    // The closing line is "}" or whatever else closes the braces, like the
+    // while of a do loop
+    void genBracedRegions(const std::vector<int>& sequence, const std::string& closingLine, bool blankLine = true)
+    {
+        addLine("{");
+        ++currentIndent;
+        
+        genRegions(sequence);
+        
+        --currentIndent;
+        addLine(closingLine);
+        
+        if(blankLine)
+            addLine("");
+    }
+    
+    std::string genCondition(IfNode* node)
+    {
+        node->condition->accept(*this);
+        return pop();
+    }
+    
     void visit(IfNode* node)
     {
         node->condition->accept(*this);
@@ -394,6 +648,20 @@ struct CodeGenerator : AstVisitor
     int currentIndent;
     
     std::stack<std::string> expStack;
+    
+    // A subtree or a piece of text genExpression still has to write
+    struct ExpressionPiece
+    {
+        ExpressionPiece(ExpressionNode* node_) : node(node_) { }
+        ExpressionPiece(const std::string& text_) : node(nullptr), text(text_) { }
+        
+        ExpressionNode* node;
+        std::string text;
+    };
+    
     bool needsReadInt;
+    
+    bool structureControlFlow;
+    ControlFlowStructurizer* structurizer;
 };
 
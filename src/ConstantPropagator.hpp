@@ -0,0 +1,453 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+
+#include "Ast.hpp"
+#include "AstVisitor.hpp"
+#include "OptimizerWorklist.hpp"
+
+// Sparse conditional constant propagation (Wegman and Zadeck). Finds the SSA
+// values that are constant and the basic blocks that can be reached together,
+// so a phi node whose only other operand comes from a branch that is never
+// taken is still found to be constant.
+//
+// Values start out undefined and blocks start out unreachable, and both are
+// only lowered once something proves otherwise. Phi nodes ignore operands
+// that are still undefined, which includes every definition in a block that
+// hasn't been reached (yet).
+//
+// The results are then applied to the statements the worklist hands out:
+// constant values and expressions are folded into integers, ifs that are
+// always true become gotos and ifs that are always false are killed. Blocks
+// that can't be reached are left for DeadCodeEliminator to remove.
+class ConstantPropagator : AstVisitor
+{
+public:
+    ConstantPropagator(CodeBlockNode* programBody_, Ast& ast_)
+        : programBody(programBody_),
+        ast(ast_),
+        totalFolded(0),
+        totalConstantsPropogated(0),
+        totalAlwaysTrueIfStatements(0),
+        totalAlwaysFalseIfStatements(0) { }
+        
+    bool propagateConstants(OptimizerWorklist& worklist_)
+    {
+        worklist = &worklist_;
+        success = false;
+        
+        // Nothing has changed since the last run
+        if(!worklist->hasPendingStatements(OptimizerWorklist::CONSTANT_PASS))
+            return false;
+            
+        findConstants();
+        
+        for(int i = 0; i < (int)values.size(); ++i)
+        {
+            SsaIntLValueNode* lValue = ast.getSsaValue(i);
+            
+            if(values[i].state == LatticeValue::CONSTANT && !lValue->hasConstantValue)
+            {
+                lValue->setConstant(values[i].value);
+                worklist->valueBecameConstant(lValue);
+                success = true;
+            }
+        }
+        
+        int position;
+        worklist->beginStatementPass(OptimizerWorklist::CONSTANT_PASS);
+        
+        while(worklist->nextStatement(position))
+        {
+            if(!reachable[worklist->getBlock(position)->id])
+                continue;
+                
+            statementChanged = false;
+            worklist->visitStatement(position, *this);
+            
+            if(statementChanged)
+            {
+                worklist->statementChanged(worklist->getStatement(position));
+                success = true;
+            }
+        }
+        
+        return success;
+    }
+    
+    void printStats()
+    {
+        printf("Total expressions folded: %d\n", totalFolded);
+        printf("Total constants propogated: %d\n", totalConstantsPropogated);
+        printf("Total always true if's replaced: %d\n", totalAlwaysTrueIfStatements);
+        printf("Total always false if's replaced: %d\n", totalAlwaysFalseIfStatements);
+    }
+    
+private:
+    struct LatticeValue
+    {
+        enum State
+        {
+            UNDEFINED,
+            CONSTANT,
+            OVERDEFINED
+        };
+        
+        LatticeValue(State state_ = UNDEFINED, int value_ = 0) : state(state_), value(value_) { }
+        
+        bool operator==(const LatticeValue& v) const
+        {
+            return state == v.state && (state != CONSTANT || value == v.value);
+        }
+        
+        bool operator!=(const LatticeValue& v) const
+        {
+            return !(*this == v);
+        }
+        
+        State state;
+        int value;
+    };
+    
+    // Solver
+    
+    void findConstants()
+    {
+        values.assign(ast.getTotalSsaValues(), LatticeValue());
+        reachable.assign(programBody->statements.size(), false);
+        markReachable(cast<BasicBlockNode>(programBody->statements.front()));
+        
+        while(blockWork.size() != 0 || statementWork.size() != 0)
+        {
+            if(statementWork.size() != 0)
+            {
+                StatementNode* node = statementWork.back();
+                statementWork.pop_back();
+                
+                if(!node->inDeadCode() && node->parentBlock && reachable[node->parentBlock->id])
+                    evaluateStatement(node);
+                    
+                continue;
+            }
+            
+            BasicBlockNode* block = blockWork.back();
+            blockWork.pop_back();
+            
+            for(StatementNode* s : block->statements)
+            {
+                if(!s->markedAsDead)
+                    evaluateStatement(s);
+            }
+            
+            markSuccessorsReachable(block);
+        }
+    }
+    
+    void evaluateStatement(StatementNode* node)
+    {
+        if(IfNode* ifNode = dyn_cast<IfNode>(node))
+        {
+            markSuccessorsReachable(ifNode->parentBlock);
+            return;
+        }
+        
+        LetStatementNode* let = dyn_cast<LetStatementNode>(node);
+        if(!let)
+            return;
+            
+        SsaIntLValueNode* lValue = dyn_cast<SsaIntLValueNode>(let->leftSide);
+        if(!lValue)
+            return;
+            
+        if(PhiNode* phi = dyn_cast<PhiNode>(let->rightSide))
+            setValue(lValue, evaluatePhi(phi));
+        else
+            setValue(lValue, evaluate(let->rightSide));
+    }
+    
+    void markSuccessorsReachable(BasicBlockNode* block)
+    {
+        for(StatementNode* s : block->statements)
+        {
+            if(s->markedAsDead)
+                continue;
+                
+            if(GotoNode* gotoNode = dyn_cast<GotoNode>(s))
+            {
+                markReachable(gotoNode->targetBlock);
+                return;
+            }
+            
+            if(IfNode* ifNode = dyn_cast<IfNode>(s))
+            {
+                LatticeValue condition = evaluate(ifNode->condition);
+                
+                if(condition.state == LatticeValue::UNDEFINED)
+                    return;
+                    
+                if(condition.state == LatticeValue::OVERDEFINED || condition.value != 0)
+                    markReachable(cast<GotoNode>(ifNode->body)->targetBlock);
+                    
+                if(condition.state == LatticeValue::CONSTANT && condition.value != 0)
+                    return;
+                    
+                break;
+            }
+        }
+        
+        if(!block->blockEndsInGoto() && block->directSuccessor != nullptr)
+            markReachable(block->directSuccessor);
+    }
+    
+    void markReachable(BasicBlockNode* block)
+    {
+        if(block->markedAsDead || reachable[block->id])
+            return;
+            
+        reachable[block->id] = true;
+        blockWork.push_back(block);
+    }
+    
+    LatticeValue getValue(SsaIntLValueNode* node)
+    {
+        if(node->hasConstantValue)
+            return LatticeValue(LatticeValue::CONSTANT, node->value);
+            
+        return values[node->ssaId];
+    }
+    
+    void setValue(SsaIntLValueNode* node, LatticeValue value)
+    {
+        // Already known from an earlier run
+        if(node->hasConstantValue)
+            return;
+            
+        LatticeValue oldValue = getValue(node);
+        LatticeValue newValue = meet(oldValue, value);
+        
+        if(newValue == oldValue)
+            return;
+            
+        values[node->ssaId] = newValue;
+        
+        for(StatementNode* user : node->users)
+            statementWork.push_back(user);
+    }
+    
+    LatticeValue meet(LatticeValue a, LatticeValue b)
+    {
+        if(a.state == LatticeValue::UNDEFINED)
+            return b;
+            
+        if(b.state == LatticeValue::UNDEFINED)
+            return a;
+            
+        if(a != b)
+            return LatticeValue(LatticeValue::OVERDEFINED);
+            
+        return a;
+    }
+    
+    LatticeValue evaluatePhi(PhiNode* node)
+    {
+        LatticeValue value;
+        
+        for(SsaIntLValueNode* joinNode : node->joinNodes)
+            value = meet(value, getValue(joinNode));
+            
+        return value;
+    }
+    
+    // Uses a stack of its own instead of recursing, as an expression can be
+    // a chain of 100k additions. An operator is on the work stack twice:
+    // first to push its operands, then to combine their values once they're
+    // on the value stack.
+    LatticeValue evaluate(ExpressionNode* root)
+    {
+        evaluationWork.clear();
+        evaluationValues.clear();
+        evaluationWork.push_back(EvaluationStep(root, false));
+        
+        while(evaluationWork.size() != 0)
+        {
+            ExpressionNode* node = evaluationWork.back().first;
+            bool operandsDone = evaluationWork.back().second;
+            evaluationWork.pop_back();
+            
+            if(BinaryOpNode* binaryOp = dyn_cast<BinaryOpNode>(node))
+            {
+                if(!operandsDone)
+                {
+                    evaluationWork.push_back(EvaluationStep(node, true));
+                    evaluationWork.push_back(EvaluationStep(binaryOp->right, false));
+                    evaluationWork.push_back(EvaluationStep(binaryOp->left, false));
+                    continue;
+                }
+                
+                LatticeValue right = popValue();
+                LatticeValue left = popValue();
+                evaluationValues.push_back(evaluateBinaryOp(binaryOp->op, left, right));
+            }
+            else if(UnaryOpNode* unaryOp = dyn_cast<UnaryOpNode>(node))
+            {
+                if(!operandsDone)
+                {
+                    evaluationWork.push_back(EvaluationStep(node, true));
+                    evaluationWork.push_back(EvaluationStep(unaryOp->value, false));
+                    continue;
+                }
+                
+                evaluationValues.push_back(evaluateUnaryOp(unaryOp->op, popValue()));
+            }
+            else
+            {
+                evaluationValues.push_back(evaluateLeaf(node));
+            }
+        }
+        
+        return evaluationValues.back();
+    }
+    
+    LatticeValue popValue()
+    {
+        LatticeValue value = evaluationValues.back();
+        evaluationValues.pop_back();
+        return value;
+    }
+    
+    LatticeValue evaluateLeaf(ExpressionNode* node)
+    {
+        if(IntegerNode* intNode = dyn_cast<IntegerNode>(node))
+            return LatticeValue(LatticeValue::CONSTANT, intNode->value);
+            
+        if(SsaIntVarFactor* var = dyn_cast<SsaIntVarFactor>(node))
+            return getValue(var->ssaLValue);
+            
+        // Input, lists, etc.
+        return LatticeValue(LatticeValue::OVERDEFINED);
+    }
+    
+    LatticeValue evaluateBinaryOp(TokenType op, LatticeValue left, LatticeValue right)
+    {
+        if(left.state == LatticeValue::OVERDEFINED || right.state == LatticeValue::OVERDEFINED)
+            return LatticeValue(LatticeValue::OVERDEFINED);
+            
+        if(left.state == LatticeValue::UNDEFINED || right.state == LatticeValue::UNDEFINED)
+            return LatticeValue();
+            
+        int result;
+        if(!BinaryOpNode::evaluate(op, left.value, right.value, result))
+            return LatticeValue(LatticeValue::OVERDEFINED);
+            
+        return LatticeValue(LatticeValue::CONSTANT, result);
+    }
+    
+    LatticeValue evaluateUnaryOp(TokenType op, LatticeValue value)
+    {
+        if(value.state != LatticeValue::CONSTANT)
+            return value;
+            
+        int result;
+        if(!UnaryOpNode::evaluate(op, value.value, result))
+            return LatticeValue(LatticeValue::OVERDEFINED);
+            
+        return LatticeValue(LatticeValue::CONSTANT, result);
+    }
+    
+    // Folding
+    
+    void replaceWithConstant(int value)
+    {
+        replaceNode(ast.newIntegerNode(value));
+        statementChanged = true;
+    }
+    
+    void visit(SsaIntVarFactor* node)
+    {
+        if(node->ssaLValue->hasConstantValue)
+        {
+            replaceWithConstant(node->ssaLValue->value);
+            ++totalConstantsPropogated;
+        }
+    }
+    
+    void visit(BinaryOpNode* node)
+    {
+        IntegerNode* left = dyn_cast<IntegerNode>(node->left);
+        IntegerNode* right = dyn_cast<IntegerNode>(node->right);
+        
+        int result;
+        if(left && right && BinaryOpNode::evaluate(node->op, left->value, right->value, result))
+        {
+            replaceWithConstant(result);
+            ++totalFolded;
+        }
+    }
+    
+    void visit(UnaryOpNode* node)
+    {
+        IntegerNode* value = dyn_cast<IntegerNode>(node->value);
+        
+        int result;
+        if(value && UnaryOpNode::evaluate(node->op, value->value, result))
+        {
+            replaceWithConstant(result);
+            ++totalFolded;
+        }
+    }
+    
+    void visit(LetStatementNode* node)
+    {
+        SsaIntLValueNode* lValue = dyn_cast<SsaIntLValueNode>(node->leftSide);
+        if(!lValue || !lValue->hasConstantValue || isa<IntegerNode>(node->rightSide))
+            return;
+            
+        // Phi node that only ever sees one value
+        node->rightSide = ast.newIntegerNode(lValue->value);
+        statementChanged = true;
+        ++totalFolded;
+    }
+    
+    void visit(IfNode* node)
+    {
+        LatticeValue condition = evaluate(node->condition);
+        if(condition.state != LatticeValue::CONSTANT)
+            return;
+            
+        if(condition.value != 0)
+        {
+            replaceNode(node->body);
+            ++totalAlwaysTrueIfStatements;
+        }
+        else
+        {
+            node->markAsDead();
+            ++totalAlwaysFalseIfStatements;
+        }
+        
+        statementChanged = true;
+    }
+    
+    CodeBlockNode* programBody;
+    Ast& ast;
+    OptimizerWorklist* worklist;
+    
+    std::vector<LatticeValue> values;     // Indexed by ssaId
+    std::vector<bool> reachable;
+    std::vector<BasicBlockNode*> blockWork;
+    std::vector<StatementNode*> statementWork;
+    
+    // An expression and whether its operands have been evaluated already
+    typedef std::pair<ExpressionNode*, bool> EvaluationStep;
+    
+    std::vector<EvaluationStep> evaluationWork;
+    std::vector<LatticeValue> evaluationValues;
+    
+    bool success;
+    bool statementChanged;
+    int totalFolded;
+    int totalConstantsPropogated;
+    int totalAlwaysTrueIfStatements;
+    int totalAlwaysFalseIfStatements;
+};
@@ -0,0 +1,456 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "Ast.hpp"
+#include "CfgAnalysis.hpp"
+#include "IdSet.hpp"
+
+// Finds the loops and ifs the parser lowered to labels and gotos again, so the
+// code generator can emit them as C loops and ifs. The blocks stay in the
+// order they're in, and a structured statement always covers a run of blocks
+// that's nested properly inside the statement around it, so a jump the
+// structure doesn't account for can stay a goto: C allows jumping into and out
+// of blocks, and control falls from a block into the next one just like it did
+// before.
+//
+// A natural loop whose blocks are all next to each other becomes
+//
+//  - do { ... } while(c)       if its last block ends with if c goto header
+//  - while(!c) { ... }         if its last block ends with goto header, and the
+//                              header does nothing but if c goto the next block
+//  - for(;;) { ... }           for any other last block ending with goto header
+//  - while(c) { ... }          if the header is the last block and does nothing
+//                              but if c goto the first block, entered with a
+//                              goto from before the loop (a lowered while loop)
+//
+// Inside a loop, a jump to the block after it becomes break, and one to the
+// header becomes continue where that runs the same code. An if c goto further
+// down the same run of blocks becomes if(!c) { ... }, with an else if the
+// skipped blocks end with a goto further down still. Irreducible loops, loops
+// that are split up and any other jumps stay gotos, and only the labels a goto
+// is left for are emitted.
+class ControlFlowStructurizer
+{
+public:
+    enum RegionKind
+    {
+        REGION_BLOCK,
+        REGION_LOOP,
+        REGION_IF
+    };
+    
+    enum LoopForm
+    {
+        LOOP_DO_WHILE,
+        LOOP_WHILE,
+        LOOP_ROTATED_WHILE,
+        LOOP_FOREVER
+    };
+    
+    // What becomes of the jump a block ends with
+    enum JumpAction
+    {
+        JUMP_GOTO,
+        JUMP_IMPLICIT,      // The structure around it does the jump
+        JUMP_BREAK,
+        JUMP_CONTINUE
+    };
+    
+    struct Region
+    {
+        Region(RegionKind kind_, int block_)
+            : kind(kind_), block(block_), form(LOOP_FOREVER), testBlock(-1), labelsHoisted(false) { }
+            
+        RegionKind kind;
+        int block;                  // First block of the region
+        LoopForm form;
+        int testBlock;              // Block whose if is the condition of a loop or if, or -1
+        bool labelsHoisted;         // Labels of the block are emitted before the loop around it
+        std::vector<int> body;
+        std::vector<int> elseBody;
+    };
+    
+    ControlFlowStructurizer(CodeBlockNode* programBody_)
+        : programBody(programBody_),
+        totalLoops(0),
+        totalIfs(0),
+        totalGotos(0)
+        { }
+        
+    void structure()
+    {
+        blocks.clear();
+        for(StatementNode* s : programBody->statements)
+            blocks.push_back(cast<BasicBlockNode>(s));
+            
+        jumpActions.assign(blocks.size(), JUMP_GOTO);
+        regions.clear();
+        
+        findLoops();
+        
+        LoopContext outside = { -1, -1 };
+        root = planSequence(0, blocks.size(), 0, outside);
+        
+        findUsedLabels();
+    }
+    
+    const std::vector<int>& getRoot()
+    {
+        return root;
+    }
+    
+    const Region& getRegion(int region)
+    {
+        return regions[region];
+    }
+    
+    BasicBlockNode* getBlock(int block)
+    {
+        return blocks[block];
+    }
+    
+    JumpAction getJumpAction(int block)
+    {
+        return jumpActions[block];
+    }
+    
+    bool isLabelUsed(LabelNode* label)
+    {
+        return usedLabels.contains(label->symbol->id);
+    }
+    
+    // The if a block ends with, or nullptr
+    IfNode* getIf(int block)
+    {
+        auto& statements = blocks[block]->statements;
+        return statements.size() != 0 ? dyn_cast<IfNode>(statements.back()) : nullptr;
+    }
+    
+    int getTotalLoops()
+    {
+        return totalLoops;
+    }
+    
+    int getTotalIfs()
+    {
+        return totalIfs;
+    }
+    
+    // Jumps left as gotos
+    int getTotalGotos()
+    {
+        return totalGotos;
+    }
+    
+private:
+    struct StructuredLoop
+    {
+        LoopForm form;
+        int first;
+        int last;
+        int header;
+    };
+    
+    struct LoopContext
+    {
+        int exitBlock;
+        int continueBlock;
+    };
+    
+    // The goto a block ends with, on its own or in an if
+    GotoNode* getJump(int block)
+    {
+        auto& statements = blocks[block]->statements;
+        if(statements.size() == 0)
+            return nullptr;
+            
+        if(GotoNode* gotoNode = dyn_cast<GotoNode>(statements.back()))
+            return gotoNode;
+        else if(IfNode* ifNode = dyn_cast<IfNode>(statements.back()))
+            return cast<GotoNode>(ifNode->body);
+            
+        return nullptr;
+    }
+    
+    int getJumpTarget(int block)
+    {
+        GotoNode* jump = getJump(block);
+        return jump ? jump->targetBlock->id : -1;
+    }
+    
+    // Whether the block does nothing but if c goto target. Phi nodes don't
+    // generate any code.
+    bool isOnlyTest(int block, int target)
+    {
+        for(StatementNode* s : blocks[block]->statements)
+        {
+            if(s->markedAsDead || isa<LabelNode>(s) || s == blocks[block]->statements.back())
+                continue;
+                
+            LetStatementNode* let = dyn_cast<LetStatementNode>(s);
+            if(!let || !isa<PhiNode>(let->rightSide))
+                return false;
+        }
+        
+        return getIf(block) && getJumpTarget(block) == target;
+    }
+    
+    void findLoops()
+    {
+        CfgAnalysis cfg(programBody);
+        
+        loopsAt.assign(blocks.size(), std::vector<StructuredLoop>());
+        
+        for(const LoopNest::Loop& loop : cfg.getLoopNest().getLoops())
+        {
+            StructuredLoop s;
+            s.first = loop.blocks.front();
+            s.last = loop.blocks.back();
+            s.header = loop.header;
+            
+            if(s.last - s.first + 1 != (int)loop.blocks.size())
+                continue;
+                
+            if(s.header == s.first && getJumpTarget(s.last) == s.header)
+            {
+                if(getIf(s.last))
+                    s.form = LOOP_DO_WHILE;
+                else if(s.first != s.last && isOnlyTest(s.header, s.last + 1))
+                    s.form = LOOP_WHILE;
+                else
+                    s.form = LOOP_FOREVER;
+            }
+            else if(s.header == s.last && s.first != s.last && isOnlyTest(s.header, s.first))
+            {
+                s.form = LOOP_ROTATED_WHILE;
+            }
+            else
+            {
+                continue;
+            }
+            
+            loopsAt[s.first].push_back(s);
+        }
+        
+        // Loops starting at the same block, outermost first
+        for(auto& loops : loopsAt)
+        {
+            std::sort(loops.begin(), loops.end(), [](const StructuredLoop& a, const StructuredLoop& b)
+            {
+                return a.last > b.last;
+            });
+        }
+    }
+    
+    // Plans the blocks [begin, end), where loops at begin before firstLoop
+    // have already been opened around it
+    std::vector<int> planSequence(int begin, int end, int firstLoop, LoopContext context)
+    {
+        std::vector<int> sequence;
+        int block = begin;
+        
+        while(block < end)
+        {
+            int loop = findLoopAt(block, end, block == begin ? firstLoop : 0);
+            
+            if(loop != -1)
+            {
+                block = planLoop(block, loop, sequence);
+                continue;
+            }
+            
+            sequence.push_back(addRegion(Region(REGION_BLOCK, block)));
+            block = planJump(block, end, context, sequence);
+        }
+        
+        return sequence;
+    }
+    
+    int findLoopAt(int block, int end, int firstLoop)
+    {
+        for(int i = firstLoop; i < (int)loopsAt[block].size(); ++i)
+        {
+            if(loopsAt[block][i].last < end)
+                return i;
+        }
+        
+        return -1;
+    }
+    
+    // Returns the block after the loop
+    int planLoop(int block, int loopIndex, std::vector<int>& sequence)
+    {
+        StructuredLoop loop = loopsAt[block][loopIndex];
+        
+        Region region(REGION_LOOP, loop.first);
+        region.form = loop.form;
+        
+        LoopContext inside = { loop.last + 1, -1 };
+        int bodyBegin = loop.first;
+        int bodyEnd = loop.last + 1;
+        
+        switch(loop.form)
+        {
+            case LOOP_DO_WHILE:
+                region.testBlock = loop.last;
+                jumpActions[loop.last] = JUMP_IMPLICIT;
+                break;
+                
+            case LOOP_WHILE:
+                region.testBlock = loop.header;
+                jumpActions[loop.header] = JUMP_IMPLICIT;
+                jumpActions[loop.last] = JUMP_IMPLICIT;
+                inside.continueBlock = loop.header;
+                bodyBegin = loop.header + 1;
+                break;
+                
+            case LOOP_ROTATED_WHILE:
+                region.testBlock = loop.header;
+                jumpActions[loop.header] = JUMP_IMPLICIT;
+                inside.continueBlock = loop.header;
+                bodyEnd = loop.header;
+                
+                // The goto into the loop goes to the test, which is next
+                if(sequence.size() != 0)
+                {
+                    Region& previous = regions[sequence.back()];
+                    GotoNode* entry = previous.kind == REGION_BLOCK && previous.block == loop.first - 1 && !getIf(previous.block) ?
+                        getJump(previous.block) : nullptr;
+                        
+                    if(entry && entry->targetBlock->id == loop.header && jumpActions[previous.block] == JUMP_GOTO)
+                        jumpActions[previous.block] = JUMP_IMPLICIT;
+                }
+                
+                break;
+                
+            case LOOP_FOREVER:
+                jumpActions[loop.last] = JUMP_IMPLICIT;
+                inside.continueBlock = loop.header;
+                break;
+        }
+        
+        int regionIndex = addRegion(region);
+        sequence.push_back(regionIndex);
+        
+        int firstLoop = bodyBegin == loop.first ? loopIndex + 1 : 0;
+        std::vector<int> body = planSequence(bodyBegin, bodyEnd, firstLoop, inside);
+        
+        if(bodyBegin == loop.first && regions[body[0]].kind == REGION_BLOCK)
+            regions[body[0]].labelsHoisted = true;
+            
+        regions[regionIndex].body.swap(body);
+        ++totalLoops;
+        
+        return loop.last + 1;
+    }
+    
+    // Decides what to do with the jump the block ends with, and returns the
+    // block to go on with
+    int planJump(int block, int end, LoopContext context, std::vector<int>& sequence)
+    {
+        int target = getJumpTarget(block);
+        
+        if(target == -1 || jumpActions[block] != JUMP_GOTO)
+            return block + 1;
+            
+        if(target == context.exitBlock)
+        {
+            jumpActions[block] = JUMP_BREAK;
+            return block + 1;
+        }
+        
+        if(target == context.continueBlock)
+        {
+            jumpActions[block] = JUMP_CONTINUE;
+            return block + 1;
+        }
+        
+        if(!getIf(block) || target <= block + 1 || target > end)
+            return block + 1;
+            
+        Region region(REGION_IF, block + 1);
+        region.testBlock = block;
+        jumpActions[block] = JUMP_IMPLICIT;
+        
+        // The skipped blocks end with a jump over the blocks after them
+        int thenLast = target - 1;
+        int elseEnd = -1;
+        
+        if(!getIf(thenLast) && jumpActions[thenLast] == JUMP_GOTO)
+        {
+            int thenTarget = getJumpTarget(thenLast);
+            
+            if(thenTarget > target && thenTarget <= end && !loopCrosses(target, thenTarget))
+            {
+                elseEnd = thenTarget;
+                jumpActions[thenLast] = JUMP_IMPLICIT;
+            }
+        }
+        
+        int regionIndex = addRegion(region);
+        sequence.push_back(regionIndex);
+        
+        std::vector<int> body = planSequence(block + 1, target, 0, context);
+        regions[regionIndex].body.swap(body);
+        
+        if(elseEnd != -1)
+        {
+            std::vector<int> elseBody = planSequence(target, elseEnd, 0, context);
+            regions[regionIndex].elseBody.swap(elseBody);
+        }
+        
+        ++totalIfs;
+        
+        return elseEnd != -1 ? elseEnd : target;
+    }
+    
+    // Whether a loop starting at the block goes past end, so that an else
+    // ending there would split it up
+    bool loopCrosses(int block, int end)
+    {
+        for(const StructuredLoop& loop : loopsAt[block])
+        {
+            if(loop.last >= end)
+                return true;
+        }
+        
+        return false;
+    }
+    
+    int addRegion(const Region& region)
+    {
+        regions.push_back(region);
+        return regions.size() - 1;
+    }
+    
+    void findUsedLabels()
+    {
+        usedLabels.clear();
+        totalGotos = 0;
+        
+        for(int block = 0; block < (int)blocks.size(); ++block)
+        {
+            GotoNode* jump = getJump(block);
+            
+            if(jump && jumpActions[block] == JUMP_GOTO)
+            {
+                usedLabels.insert(jump->label->id);
+                ++totalGotos;
+            }
+        }
+    }
+    
+    CodeBlockNode* programBody;
+    std::vector<BasicBlockNode*> blocks;
+    std::vector<std::vector<StructuredLoop>> loopsAt;
+    std::vector<JumpAction> jumpActions;
+    std::vector<Region> regions;
+    std::vector<int> root;
+    IdSet usedLabels;
+    
+    int totalLoops;
+    int totalIfs;
+    int totalGotos;
+};
@@ -3,22 +3,36 @@
 #include "Ast.hpp"
 #include "AstVisitor.hpp"
 #include "VariableReplacer.hpp"
+#include "OptimizerWorklist.hpp"
 
 class CopyPropagator : AstVisitor
 {
 public:
-    CopyPropagator(CodeBlockNode* programBody_, Ast& ast_) : programBody(programBody_), ast(ast_), totalPropagated(0) { }
+    CopyPropagator(CodeBlockNode* programBody_, Ast& ast_) : programBody(programBody_), ast(ast_), totalPropagated(0), totalRefused(0) { }
     
-    bool propagateCopies()
+    bool propagateCopies(OptimizerWorklist& worklist_)
     {
+        worklist = &worklist_;
         success = false;
-        programBody->acceptRecursive(*this);
+        
+        worklist->beginStatementPass(OptimizerWorklist::COPY_PASS);
+        
+        while(worklist->nextStatement(position))
+        {
+            statementChanged = false;
+            worklist->visitStatement(position, *this);
+            
+            if(statementChanged)
+                worklist->statementChanged(worklist->getStatement(position));
+        }
+        
         return success;
     }
     
     void printStats()
     {
         printf("Total variables propogated: %d\n", totalPropagated);
+        printf("Copies kept for a later redefinition: %d\n", totalRefused);
     }
     
 private:
@@ -26,30 +40,67 @@ private:
     {        
         if(node->joinNodes.size() == 1)
         {
-            replaceNode(ast.addSsaIntVarFactorNode(*node->joinNodes.begin()));
+            ExpressionNode* var = ast.addSsaIntVarFactorNode(*node->joinNodes.begin());
+            replaceNode(var);
             ++totalPropagated;
             success = true;
+            statementChanged = true;
+            worklist->usesAdded(var);
         }
     }
     
     void visit(LetStatementNode* node)
     {
-        SsaIntLValueNode* lValue = dynamic_cast<SsaIntLValueNode*>(node->leftSide);
+        SsaIntLValueNode* lValue = dyn_cast<SsaIntLValueNode>(node->leftSide);
         if(!lValue)
             return;
         
-        if(auto var = dynamic_cast<SsaIntVarFactor*>(node->rightSide))
+        if(auto var = dyn_cast<SsaIntVarFactor>(node->rightSide))
         {
-            VariableReplacer replacer(programBody, lValue, var);
-            success |= replacer.replaceVars();
-            ++totalPropagated;
+            if(isRedefinedBeforeUse(lValue, var))
+            {
+                ++totalRefused;
+                return;
+            }
+            
+            VariableReplacer replacer(lValue, var);
+            
+            if(replacer.replaceVars())
+            {
+                worklist->variableReplaced(var, replacer.getChangedStatements());
+                ++totalPropagated;
+                success = true;
+            }
+            
             //node->markAsDead();
         }
     }
     
+    // The uses keep the variable name of the copy, so the copy can't be
+    // propagated to a use that might see a later definition of var's variable
+    bool isRedefinedBeforeUse(SsaIntLValueNode* lValue, SsaIntVarFactor* var)
+    {
+        for(StatementNode* user : lValue->users)
+        {
+            // Phi nodes aren't rewritten
+            LetStatementNode* let = dyn_cast<LetStatementNode>(user);
+            if(let && isa<PhiNode>(let->rightSide))
+                continue;
+                
+            if(worklist->isRedefinedBefore(var->var, position, user))
+                return true;
+        }
+        
+        return false;
+    }
+    
     CodeBlockNode* programBody;
+    OptimizerWorklist* worklist;
+    int position;
     bool success;
+    bool statementChanged;
     Ast& ast;
     int totalPropagated;
+    int totalRefused;
 };
 
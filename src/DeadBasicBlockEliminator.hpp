@@ -1,11 +1,11 @@
 #pragma once
 
-#include <set>
 #include <queue>
 #include <vector>
 
 #include "Ast.hpp"
 #include "AstVisitor.hpp"
+#include "IdSet.hpp"
 
 class DeadBasicBlockEliminator
 {
@@ -16,20 +16,19 @@ public:
     {
         std::vector<BasicBlockNode*> deadBlocks;
         
-        workQueue.push(dynamic_cast<BasicBlockNode*>(programBody->statements.front()));
+        workQueue.push(cast<BasicBlockNode>(programBody->statements.front()));
         
         while(workQueue.size() > 0)
         {
             BasicBlockNode* node = workQueue.front();
-            ++refCount[node];
             workQueue.pop();
             visitBlock(node);
         }
         
         for(auto s : programBody->statements)
         {
-            BasicBlockNode* node = dynamic_cast<BasicBlockNode*>(s);
-            if(refCount[node] == 0 && !node->markedAsDead)
+            BasicBlockNode* node = cast<BasicBlockNode>(s);
+            if(!visitedBlocks.contains(node->statementId) && !node->markedAsDead)
                 deadBlocks.push_back(node);
         }
         
@@ -39,21 +38,23 @@ public:
 private:
     void visitBlock(BasicBlockNode* node)
     {
-        if(visitedBlocks.count(node) != 0)
+        if(!visitedBlocks.insert(node->statementId))
             return;
         
-        visitedBlocks.insert(node);
-        
         for(auto s : node->statements)
         {
-            if(GotoNode* gotoNode = dynamic_cast<GotoNode*>(s))
+            // Ifs that are always false have been killed
+            if(s->markedAsDead)
+                continue;
+                
+            if(GotoNode* gotoNode = dyn_cast<GotoNode>(s))
             {
                 workQueue.push(gotoNode->targetBlock);
                 break;
             }
-            else if(IfNode* ifNode = dynamic_cast<IfNode*>(s))
+            else if(IfNode* ifNode = dyn_cast<IfNode>(s))
             {
-                workQueue.push(dynamic_cast<GotoNode*>(ifNode->body)->targetBlock);
+                workQueue.push(cast<GotoNode>(ifNode->body)->targetBlock);
                 break;
             }
         }
@@ -65,8 +66,7 @@ private:
     }
     
     CodeBlockNode* programBody;
-    std::set<BasicBlockNode*> visitedBlocks;
+    IdSet visitedBlocks;
     std::queue<BasicBlockNode*> workQueue;
-    std::map<BasicBlockNode*, int> refCount;
 };
 
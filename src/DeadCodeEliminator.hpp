@@ -1,31 +1,33 @@
 #pragma once
 
-#include <set>
 #include <queue>
 
 #include "Ast.hpp"
 #include "AstVisitor.hpp"
+#include "IdSet.hpp"
 #include "IoStatementFinder.hpp"
 #include "StatementKiller.hpp"
 #include "DeadBasicBlockEliminator.hpp"
+#include "OptimizerWorklist.hpp"
 
 class DeadCodeEliminator : AstVisitor
 {
 public:
     DeadCodeEliminator(CodeBlockNode* programBody_)
-        : programBody(programBody_), totalKilledStatements(0), totalKilledBlocks(0), totalKilledIfs(0) { }
+        : programBody(programBody_), totalKilledStatements(0), totalKilledBlocks(0) { }
     
-    bool eliminateDeadCode()
+    bool eliminateDeadCode(OptimizerWorklist& worklist)
     {
-        success = false;
+        if(!worklist.needsDeadCodeElimination())
+            return false;
+        
         liveStatements.clear();
         killedStatements.clear();
         
         IoStatementFinder finder(programBody);
-        liveStatements = finder.findIoStatements();
         
-        for(auto s : liveStatements)
-            workQueue.push(s);
+        for(auto s : finder.findIoStatements())
+            scheduleNode(s);
         
         while(workQueue.size() > 0)
         {
@@ -34,40 +36,44 @@ public:
             s->acceptRecursive(*this);
         }
         
-        eliminateDeadBasicBlocks();
+        bool killedBlocks = eliminateDeadBasicBlocks();
         
         StatementKiller killer(programBody, liveStatements, killedStatements);
-        bool worked = killer.killDeadStatements() || success;
+        bool worked = killer.killDeadStatements();
         totalKilledStatements += killer.getTotalKilledStatements();
         
+        for(auto s : killer.getKilledLets())
+            worklist.statementKilled(s);
+        
+        worklist.deadCodeEliminated(killedBlocks);
+        
         return worked;
     }
     
     void printStats()
     {
-        printf("Total always false if's replaced: %d\n", totalKilledIfs);
         printf("Total dead statements eliminated: %d\n", totalKilledStatements);
         printf("Total dead blocks eliminated: %d\n", totalKilledBlocks);
     }
     
 private:    
-    void eliminateDeadBasicBlocks()
+    bool eliminateDeadBasicBlocks()
     {
         DeadBasicBlockEliminator basicBlockEliminator(programBody);
         auto killedBlocks = basicBlockEliminator.eliminateDeadBlocks();
         
-        killedStatements.insert(killedBlocks.begin(), killedBlocks.end());
+        for(auto block : killedBlocks)
+            killedStatements.insert(block->statementId);
         
         totalKilledBlocks += killedBlocks.size();
+        
+        return killedBlocks.size() != 0;
     }
     
     void scheduleNode(StatementNode* node)
     {
-        if(liveStatements.count(node) != 0)
-            return;
-        
-        liveStatements.insert(node);
-        workQueue.push(node);
+        if(liveStatements.insert(node->statementId))
+            workQueue.push(node);
     }
     
     void visit(SsaIntLValueNode* node)
@@ -86,26 +92,11 @@ private:
             scheduleNode(joinNode->definitionNode);
     }
     
-    void visit(IfNode* node)
-    {
-        if(auto intNode = dynamic_cast<IntegerNode*>(node->condition))
-        {
-            if(intNode->value == 0)
-            {
-                node->markAsDead();
-                success = true;
-                ++totalKilledIfs;
-            }
-        }
-    }
-    
     CodeBlockNode* programBody;
-    std::set<StatementNode*> liveStatements;
-    std::set<StatementNode*> killedStatements;
+    IdSet liveStatements;
+    IdSet killedStatements;
     std::queue<StatementNode*> workQueue;
-    bool success;
     int totalKilledStatements;
     int totalKilledBlocks;
-    int totalKilledIfs;
 };
 
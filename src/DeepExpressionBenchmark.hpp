@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <chrono>
+#include <vector>
+
+#include "BenchmarkBase.hpp"
+#include "Optimizer.hpp"
+#include "PolynomialSimplifier.hpp"
+#include "CodeGenerator.hpp"
+
+// Compiles a generated program with an expression far too deep to recurse
+// over
+class DeepExpressionBenchmark : BenchmarkBase
+{
+public:
+    DeepExpressionBenchmark(SourceBuffer& source_) : BenchmarkBase(source_) { }
+    
+    // Compiles a program that sums a variable DEEP_EXPRESSION_TERMS times in
+    // one expression, with and without the optimizer. The variable is 1, so
+    // the optimized program has to print the number of terms.
+    void run()
+    {
+        std::string program = "title deep expression\nvar\n   int a\n   int b\nbegin\n   let a = 1\n   let b = a";
+        
+        for(int i = 1; i < DEEP_EXPRESSION_TERMS; ++i)
+            program += " + a";
+            
+        program += "\n   print b\nend\n";
+        
+        std::vector<std::string> unoptimizedCode;
+        std::vector<std::string> optimizedCode;
+        
+        double unoptimizedTime = compileProgram(program, false, unoptimizedCode);
+        double optimizedTime = compileProgram(program, true, optimizedCode);
+        
+        std::string expectedLine = "printf(\"%d\", " + std::to_string(DEEP_EXPRESSION_TERMS) + ");";
+        bool folded = false;
+        
+        for(std::string& line : optimizedCode)
+        {
+            if(line.find(expectedLine) != std::string::npos)
+                folded = true;
+        }
+        
+        printf("Deep expression, %d terms: %.3f ms, %.3f ms optimized (%s)\n", DEEP_EXPRESSION_TERMS,
+            unoptimizedTime, optimizedTime, folded ? "folded" : "NOT folded");
+    }
+    
+private:
+    static const int DEEP_EXPRESSION_TERMS = 100000;
+    
+    // Compiles a program to C the way the compiler does and returns how long
+    // it took in ms
+    double compileProgram(const std::string& program, bool optimize, std::vector<std::string>& output)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+        
+        auto parsed = parseSource(program.c_str(), program.c_str() + program.size());
+        Ast& ast = parsed->ast;
+        
+        ast.defaultInitializeVars();
+        ast.splitIntoBasicBlocks();
+        
+        if(optimize)
+        {
+            Optimizer optimizer(ast.getBody(), ast);
+            optimizer.optimize();
+        }
+        
+        PolynomialSimplifier polySimplifier(ast, ast.getBody());
+        
+        CodeGenerator gen;
+        gen.genCode(ast);
+        output = gen.output;
+        
+        return getMilliseconds(startTime, std::chrono::steady_clock::now());
+    }
+};
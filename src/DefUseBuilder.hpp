@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Ast.hpp"
+#include "AstVisitor.hpp"
+
+// Records, for every SSA value, the statements that read it and the phi
+// nodes that list it as an operand (see SsaIntLValueNode::users/phiUses).
+class DefUseBuilder : AstVisitor
+{
+public:
+    DefUseBuilder()
+        { visitLetBefore = true; }
+        
+    void buildDefUseChains(CodeBlockNode* programBody)
+    {
+        currentStatement = nullptr;
+        programBody->acceptRecursive(*this);
+    }
+    
+    // Registers the uses inside an expression that has just been inserted into user
+    void addUses(ExpressionNode* node, StatementNode* user)
+    {
+        currentStatement = user;
+        node->acceptRecursive(*this);
+    }
+    
+private:
+    void visit(StatementNode* node)
+    {
+        currentStatement = node;
+    }
+    
+    void visit(SsaIntVarFactor* node)
+    {
+        node->ssaLValue->addUser(currentStatement);
+    }
+    
+    void visit(PhiNode* node)
+    {
+        for(auto joinNode : node->joinNodes)
+        {
+            joinNode->addUser(currentStatement);
+            joinNode->addPhiUse(node);
+        }
+    }
+    
+    StatementNode* currentStatement;
+};
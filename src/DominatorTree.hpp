@@ -0,0 +1,288 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "Ast.hpp"
+
+// Dominator tree and dominance frontiers of the basic block graph, computed
+// with the iterative algorithm from Cooper, Harvey and Kennedy's "A Simple,
+// Fast Dominance Algorithm".
+//
+// Blocks are numbered by their id (their position in the program body).
+// Blocks that can't be reached from the first block are still part of the
+// program, so a virtual root numbered getTotalBlocks() gets an edge to the
+// first block and to one block of every unreachable region. Edges come from
+// the blocks' successor lists; edges to and from deleted blocks and blocks
+// killed by the optimizer are ignored since those blocks are never emitted.
+class DominatorTree
+{
+public:
+    DominatorTree(CodeBlockNode* programBody)
+    {
+        for(StatementNode* s : programBody->statements)
+            blocks.push_back(cast<BasicBlockNode>(s));
+            
+        root = blocks.size();
+        
+        buildGraph();
+        buildReversePostorder();
+        buildImmediateDominators();
+        numberTree();
+        buildDominanceFrontiers();
+    }
+    
+    int getTotalBlocks()
+    {
+        return blocks.size();
+    }
+    
+    int getRoot()
+    {
+        return root;
+    }
+    
+    BasicBlockNode* getBlock(int id)
+    {
+        return blocks[id];
+    }
+    
+    int getImmediateDominator(int id)
+    {
+        return immediateDominator[id];
+    }
+    
+    // Whether every path from the root to b goes through a. A block dominates
+    // itself.
+    bool dominates(int a, int b)
+    {
+        return treeEnter[a] <= treeEnter[b] && treeExit[b] <= treeExit[a];
+    }
+    
+    // Every block, starting with the root, in reverse postorder of a depth
+    // first search of the graph. A block comes before its successors except
+    // along back edges.
+    const std::vector<int>& getReversePostorder()
+    {
+        return reversePostorder;
+    }
+    
+    const std::vector<int>& getChildren(int id)
+    {
+        return children[id];
+    }
+    
+    const std::vector<int>& getDominanceFrontier(int id)
+    {
+        return dominanceFrontier[id];
+    }
+    
+    // Successors and predecessors include the edges from the virtual root
+    const std::vector<int>& getSuccessors(int id)
+    {
+        return successors[id];
+    }
+    
+    const std::vector<int>& getPredecessors(int id)
+    {
+        return predecessors[id];
+    }
+    
+private:
+    void buildGraph()
+    {
+        successors.resize(blocks.size() + 1);
+        predecessors.resize(blocks.size() + 1);
+        
+        for(int i = 0; i < (int)blocks.size(); ++i)
+        {
+            if(blocks[i]->markedAsDead)
+                continue;
+                
+            for(BasicBlockNode* successor : blocks[i]->successors)
+            {
+                if(!successor->deleted && !successor->markedAsDead)
+                    successors[i].push_back(successor->id);
+            }
+            
+            std::sort(successors[i].begin(), successors[i].end());
+            
+            for(int successor : successors[i])
+                predecessors[successor].push_back(i);
+        }
+    }
+    
+    void buildReversePostorder()
+    {
+        postorderNumber.resize(blocks.size() + 1, -1);
+        
+        for(int i = 0; i < (int)blocks.size(); ++i)
+        {
+            if(postorderNumber[i] != -1)
+                continue;
+                
+            successors[root].push_back(i);
+            predecessors[i].push_back(root);
+            depthFirstSearch(i);
+        }
+        
+        postorderNumber[root] = postorder.size();
+        postorder.push_back(root);
+        
+        reversePostorder.assign(postorder.rbegin(), postorder.rend());
+    }
+    
+    void depthFirstSearch(int start)
+    {
+        // (block, index of the next successor to visit)
+        std::vector<std::pair<int, int>> stack;
+        
+        postorderNumber[start] = -2;
+        stack.push_back(std::make_pair(start, 0));
+        
+        while(stack.size() != 0)
+        {
+            int block = stack.back().first;
+            int& next = stack.back().second;
+            
+            if(next < (int)successors[block].size())
+            {
+                int successor = successors[block][next++];
+                
+                if(postorderNumber[successor] == -1)
+                {
+                    postorderNumber[successor] = -2;
+                    stack.push_back(std::make_pair(successor, 0));
+                }
+            }
+            else
+            {
+                postorderNumber[block] = postorder.size();
+                postorder.push_back(block);
+                stack.pop_back();
+            }
+        }
+    }
+    
+    void buildImmediateDominators()
+    {
+        immediateDominator.resize(blocks.size() + 1, -1);
+        immediateDominator[root] = root;
+        
+        bool changed = true;
+        while(changed)
+        {
+            changed = false;
+            
+            for(auto it = postorder.rbegin() + 1; it != postorder.rend(); ++it)
+            {
+                int block = *it;
+                int newDominator = -1;
+                
+                for(int predecessor : predecessors[block])
+                {
+                    if(immediateDominator[predecessor] == -1)
+                        continue;
+                        
+                    if(newDominator == -1)
+                        newDominator = predecessor;
+                    else
+                        newDominator = intersect(predecessor, newDominator);
+                }
+                
+                if(immediateDominator[block] != newDominator)
+                {
+                    immediateDominator[block] = newDominator;
+                    changed = true;
+                }
+            }
+        }
+        
+        children.resize(blocks.size() + 1);
+        
+        for(int i = 0; i < (int)blocks.size(); ++i)
+            children[immediateDominator[i]].push_back(i);
+    }
+    
+    // Numbers the dominator tree in depth first order, so that a dominates b
+    // exactly when b's subtree is nested in a's
+    void numberTree()
+    {
+        treeEnter.resize(blocks.size() + 1);
+        treeExit.resize(blocks.size() + 1);
+        
+        // Blocks to enter, and ~block for blocks to leave
+        std::vector<int> work(1, root);
+        int counter = 0;
+        
+        while(work.size() != 0)
+        {
+            int block = work.back();
+            work.pop_back();
+            
+            if(block < 0)
+            {
+                treeExit[~block] = counter++;
+                continue;
+            }
+            
+            treeEnter[block] = counter++;
+            work.push_back(~block);
+            
+            for(int child : children[block])
+                work.push_back(child);
+        }
+    }
+    
+    int intersect(int a, int b)
+    {
+        while(a != b)
+        {
+            while(postorderNumber[a] < postorderNumber[b])
+                a = immediateDominator[a];
+                
+            while(postorderNumber[b] < postorderNumber[a])
+                b = immediateDominator[b];
+        }
+        
+        return a;
+    }
+    
+    void buildDominanceFrontiers()
+    {
+        dominanceFrontier.resize(blocks.size() + 1);
+        
+        for(int i = 0; i < (int)blocks.size(); ++i)
+        {
+            if(predecessors[i].size() < 2)
+                continue;
+                
+            for(int predecessor : predecessors[i])
+            {
+                for(int runner = predecessor; runner != immediateDominator[i]; runner = immediateDominator[runner])
+                {
+                    std::vector<int>& frontier = dominanceFrontier[runner];
+                    
+                    if(frontier.size() != 0 && frontier.back() == i)
+                        break;
+                        
+                    frontier.push_back(i);
+                }
+            }
+        }
+    }
+    
+    std::vector<BasicBlockNode*> blocks;
+    int root;
+    
+    std::vector<std::vector<int>> successors;
+    std::vector<std::vector<int>> predecessors;
+    std::vector<int> postorder;
+    std::vector<int> postorderNumber;
+    std::vector<int> reversePostorder;
+    std::vector<int> immediateDominator;
+    std::vector<int> treeEnter;
+    std::vector<int> treeExit;
+    std::vector<std::vector<int>> children;
+    std::vector<std::vector<int>> dominanceFrontier;
+};
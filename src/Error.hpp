@@ -3,40 +3,29 @@
 #include <string>
 #include <iostream>
 
+#include "LineIndex.hpp"
+
+// Errors point at a byte offset into the source (or -1 if they aren't tied to
+// a location), which is only turned into a line and column when printed
 struct CompileError
 {
-    CompileError(std::string message_, std::string phase_, int line_, int col_)
-        : message(message_), phase(phase_), line(line_), col(col_) { }
+    CompileError(std::string message_, std::string phase_, int offset_)
+        : message(message_), phase(phase_), offset(offset_) { }
     
-    void print(std::string& fileContents)
+    void print(const LineIndex& lines)
     {
+        int line = lines.getLine(offset);
+        int col = lines.getColumn(offset);
+        
         std::cerr << "Error on line " << line << ", col " << col << ": " << message << std::endl;
-        printErrorLine(fileContents);
+        printErrorLine(lines, line, col);
         std::cerr << phase << " failed" << std::endl;
     }
     
-    void printErrorLine(std::string& fileContents)
+    void printErrorLine(const LineIndex& lines, int line, int col)
     {
-        const char* lineStart = &fileContents[0];
-        
-        int curLine = 1;
-        int curCol = 1;
-        
-        while(curLine != line)
-        {
-            ++curCol;
-            
-            if(*lineStart == '\n')
-            {
-                ++curLine;
-                curCol = 1;
-            }
-            
-            ++lineStart;
-        }
-        
-        while(*lineStart != '\n' && *lineStart != '\0')
-            std::cerr << *lineStart++;
+        if(line > 0)
+            std::cerr.write(lines.getLineBegin(line), lines.getLineEnd(line) - lines.getLineBegin(line));
         
         std::cerr << std::endl;
         
@@ -48,7 +37,5 @@ struct CompileError
     
     std::string message;
     std::string phase;
-    int line;
-    int col;
+    int offset;
 };
-
@@ -1,20 +1,106 @@
 #include <cstdio>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define HAVE_MMAP
+#endif
+
 #include "File.hpp"
 
-std::string readFileContents(std::string fileName)
+SourceBuffer::SourceBuffer(std::string fileName) : data(nullptr), length(0), mapped(false)
+{
+    if(!mapFile(fileName))
+        readFile(fileName);
+}
+
+SourceBuffer::~SourceBuffer()
+{
+#ifdef HAVE_MMAP
+    if(mapped)
+        munmap((void*)data, length);
+#endif
+}
+
+bool SourceBuffer::mapFile(std::string& fileName)
+{
+#ifdef HAVE_MMAP
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if(fd == -1)
+        return false;
+    
+    struct stat info;
+    if(fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        close(fd);
+        return false;
+    }
+    
+    // The rest of the last page is zero filled, which gives us the '\0' at the
+    // end for free. A file that fills its last page exactly has to be read.
+    size_t fileSize = info.st_size;
+    long pageSize = sysconf(_SC_PAGESIZE);
+    
+    if(fileSize == 0 || pageSize <= 0 || fileSize % pageSize == 0)
+    {
+        close(fd);
+        return false;
+    }
+    
+    void* address = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    
+    if(address == MAP_FAILED)
+        return false;
+    
+    data = (const char*)address;
+    length = fileSize;
+    mapped = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void SourceBuffer::readFile(std::string& fileName)
 {
-    std::string contents;
     FILE* file = fopen(fileName.c_str(), "rb");
     
     if(!file)
         throw "Failed to open file: " + fileName;
     
-    int c;
-    while((c = fgetc(file)) != EOF)
-        contents += (char)c;
+    long fileSize = 0;
+    if(fseek(file, 0, SEEK_END) == 0)
+    {
+        fileSize = ftell(file);
+        
+        if(fileSize < 0 || fseek(file, 0, SEEK_SET) != 0)
+            fileSize = 0;
+    }
+    
+    contents.resize(fileSize + 1);
+    length = fread(&contents[0], 1, fileSize, file);
+    
+    // Pipes can't tell how long they are, so they're read until they end
+    const size_t READ_CHUNK_SIZE = 64 * 1024;
     
-    return contents;
+    while(!feof(file) && !ferror(file))
+    {
+        contents.resize(length + READ_CHUNK_SIZE + 1);
+        length += fread(&contents[length], 1, READ_CHUNK_SIZE, file);
+    }
+    
+    bool failed = ferror(file) != 0;
+    fclose(file);
+    
+    if(failed)
+        throw "Failed to read file: " + fileName;
+        
+    contents.resize(length + 1);
+    contents[length] = '\0';
+    data = &contents[0];
 }
 
 void writeFileContents(std::string fileName, std::vector<std::string>& lines)
@@ -29,5 +115,7 @@ void writeFileContents(std::string fileName, std::vector<std::string>& lines)
         fwrite(&lines[i][0], lines[i].size(), 1, file);
         fputc('\n', file);
     }
+    
+    fclose(file);
 }
 
@@ -2,7 +2,46 @@
 
 #include <string>
 #include <vector>
+#include <cstddef>
+
+#include "LineIndex.hpp"
+
+// The contents of a source file, followed by a '\0' the lexer can stop on.
+// The file is memory mapped when possible so it's never copied, otherwise it's
+// read into memory with a single read.
+class SourceBuffer
+{
+public:
+    SourceBuffer(std::string fileName);
+    ~SourceBuffer();
+    
+    const char* begin() const { return data; }
+    const char* end() const { return data + length; }
+    size_t size() const { return length; }
+    
+    // Built the first time it's needed, which is usually only to report an
+    // error
+    const LineIndex& getLineIndex()
+    {
+        if(!lineIndex.isBuilt())
+            lineIndex.build(begin(), end());
+            
+        return lineIndex;
+    }
+    
+private:
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+    
+    bool mapFile(std::string& fileName);
+    void readFile(std::string& fileName);
+    
+    const char* data;
+    size_t length;
+    bool mapped;
+    std::vector<char> contents;
+    LineIndex lineIndex;
+};
 
-std::string readFileContents(std::string fileName);
 void writeFileContents(std::string fileName, std::vector<std::string>& lines);
 
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+
+#include "Ast.hpp"
+
+enum FlatOpcode
+{
+    FLAT_INTEGER,
+    FLAT_VAR,
+    FLAT_BINARY_OP,
+    FLAT_UNARY_OP,
+    FLAT_ONE_DIMENSIONAL_LIST,
+    FLAT_TWO_DIMENSIONAL_LIST,
+    FLAT_THREE_DIMENSIONAL_LIST,
+    FLAT_LEAF
+};
+
+// A flat copy of expression trees, stored as parallel arrays indexed by a
+// 32-bit expression id. Each tree is laid out in postorder, so the operands of
+// an expression always come before it and a whole subtree is the contiguous
+// range [subtreeBegin[id], id]. Passes that only need to look at arithmetic can
+// then run over it with a linear scan and a value stack instead of chasing
+// pointers through virtual calls.
+//
+// Integers, variables, list elements and operators are flattened. The indices
+// of a list element are the subtrees just before it, in order. Anything else
+// (input, phi and polynomial nodes) is kept as a FLAT_LEAF pointing back at the
+// tree node.
+struct FlatExpressions
+{
+    // Flattens the tree rooted at root and returns the id of the root
+    int add(ExpressionNode* root)
+    {
+        pending.push_back(std::make_pair(root, false));
+        
+        while(pending.size() != 0)
+        {
+            ExpressionNode* node = pending.back().first;
+            bool operandsAdded = pending.back().second;
+            pending.pop_back();
+            
+            if(BinaryOpNode* binaryOp = dyn_cast<BinaryOpNode>(node))
+            {
+                if(!operandsAdded)
+                {
+                    pending.push_back(std::make_pair(node, true));
+                    pending.push_back(std::make_pair(binaryOp->right, false));
+                    pending.push_back(std::make_pair(binaryOp->left, false));
+                    continue;
+                }
+                
+                // The right operand was added last, and the left one ends
+                // just before it
+                int right = size() - 1;
+                int left = subtreeBegin[right] - 1;
+                addEntry(FLAT_BINARY_OP, binaryOp->op, left, right, 0, subtreeBegin[left]);
+            }
+            else if(UnaryOpNode* unaryOp = dyn_cast<UnaryOpNode>(node))
+            {
+                if(!operandsAdded)
+                {
+                    pending.push_back(std::make_pair(node, true));
+                    pending.push_back(std::make_pair(unaryOp->value, false));
+                    continue;
+                }
+                
+                int value = size() - 1;
+                addEntry(FLAT_UNARY_OP, unaryOp->op, value, -1, 0, subtreeBegin[value]);
+            }
+            else if(OneDimensionalListFactor* list = dyn_cast<OneDimensionalListFactor>(node))
+            {
+                if(!operandsAdded)
+                {
+                    pending.push_back(std::make_pair(node, true));
+                    pending.push_back(std::make_pair(list->index, false));
+                    continue;
+                }
+                
+                addListElement(FLAT_ONE_DIMENSIONAL_LIST, list->var, 1);
+            }
+            else if(TwoDimensionalListFactor* list = dyn_cast<TwoDimensionalListFactor>(node))
+            {
+                if(!operandsAdded)
+                {
+                    pending.push_back(std::make_pair(node, true));
+                    pending.push_back(std::make_pair(list->index1, false));
+                    pending.push_back(std::make_pair(list->index0, false));
+                    continue;
+                }
+                
+                addListElement(FLAT_TWO_DIMENSIONAL_LIST, list->var, 2);
+            }
+            else if(ThreeDimensionalListFactor* list = dyn_cast<ThreeDimensionalListFactor>(node))
+            {
+                if(!operandsAdded)
+                {
+                    pending.push_back(std::make_pair(node, true));
+                    pending.push_back(std::make_pair(list->index2, false));
+                    pending.push_back(std::make_pair(list->index1, false));
+                    pending.push_back(std::make_pair(list->index0, false));
+                    continue;
+                }
+                
+                addListElement(FLAT_THREE_DIMENSIONAL_LIST, list->var, 3);
+            }
+            else if(IntegerNode* integer = dyn_cast<IntegerNode>(node))
+            {
+                addEntry(FLAT_INTEGER, TOK_INVALID, -1, -1, integer->value, size());
+            }
+            else if(IntVarFactor* var = dyn_cast<IntVarFactor>(node))
+            {
+                addEntry(FLAT_VAR, TOK_INVALID, -1, -1, vars.size(), size());
+                vars.push_back(var->var);
+            }
+            else
+            {
+                addEntry(FLAT_LEAF, TOK_INVALID, -1, -1, leaves.size(), size());
+                leaves.push_back(node);
+            }
+        }
+        
+        return size() - 1;
+    }
+    
+    // Evaluates every expression that's a compile time constant, the same way
+    // ExpressionNode::tryEvaluate does, in a single pass
+    void foldConstants()
+    {
+        values.resize(size());
+        known.resize(size());
+        
+        for(int i = 0; i < size(); ++i)
+        {
+            switch(opcodes[i])
+            {
+                case FLAT_INTEGER:
+                    values[i] = immediates[i];
+                    known[i] = true;
+                    break;
+                    
+                case FLAT_VAR:
+                case FLAT_ONE_DIMENSIONAL_LIST:
+                case FLAT_TWO_DIMENSIONAL_LIST:
+                case FLAT_THREE_DIMENSIONAL_LIST:
+                    known[i] = false;
+                    break;
+                    
+                case FLAT_BINARY_OP:
+                    known[i] = known[left[i]] && known[right[i]] && BinaryOpNode::evaluate((TokenType)ops[i], values[left[i]], values[right[i]], values[i]);
+                    break;
+                    
+                case FLAT_UNARY_OP:
+                    known[i] = known[left[i]] && UnaryOpNode::evaluate((TokenType)ops[i], values[left[i]], values[i]);
+                    break;
+                    
+                case FLAT_LEAF:
+                    known[i] = leaves[immediates[i]]->tryEvaluate(values[i]);
+                    break;
+            }
+        }
+    }
+    
+    int size() const
+    {
+        return opcodes.size();
+    }
+    
+    void clear()
+    {
+        opcodes.clear();
+        ops.clear();
+        left.clear();
+        right.clear();
+        immediates.clear();
+        subtreeBegin.clear();
+        vars.clear();
+        leaves.clear();
+        values.clear();
+        known.clear();
+    }
+    
+    std::vector<unsigned char> opcodes;
+    std::vector<unsigned char> ops;         // TokenType of operators
+    std::vector<int> left;                  // Operand of unary operators
+    std::vector<int> right;
+    std::vector<int> immediates;            // Integer value, or index into vars or leaves
+    std::vector<int> subtreeBegin;
+    
+    std::vector<VarDeclNode*> vars;
+    std::vector<ExpressionNode*> leaves;
+    
+    // Filled in by foldConstants()
+    std::vector<int> values;
+    std::vector<unsigned char> known;
+    
+private:
+    // The indices were added just before the list element
+    void addListElement(FlatOpcode opcode, VarDeclNode* var, int totalIndices)
+    {
+        int begin = size();
+        for(int i = 0; i < totalIndices; ++i)
+            begin = subtreeBegin[begin - 1];
+            
+        addEntry(opcode, TOK_INVALID, -1, -1, vars.size(), begin);
+        vars.push_back(var);
+    }
+    
+    void addEntry(FlatOpcode opcode, TokenType op, int leftId, int rightId, int immediate, int begin)
+    {
+        opcodes.push_back(opcode);
+        ops.push_back(op);
+        left.push_back(leftId);
+        right.push_back(rightId);
+        immediates.push_back(immediate);
+        subtreeBegin.push_back(begin);
+    }
+    
+    std::vector<std::pair<ExpressionNode*, bool>> pending;
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include <utility>
+
+#include "BenchmarkBase.hpp"
+#include "AstVisitor.hpp"
+#include "FlatExpressions.hpp"
+
+// Folds the constants in the source's expressions, as trees and as
+// FlatExpressions
+class FoldingBenchmark : BenchmarkBase
+{
+public:
+    FoldingBenchmark(SourceBuffer& source_) : BenchmarkBase(source_) { }
+    
+    // Folds every expression in the program (and every subexpression) by
+    // walking the trees with a visitor, the way the optimizer's passes do, and
+    // by scanning a flattened copy of them
+    void run()
+    {
+        auto parsed = parseSource();
+        Ast& ast = parsed->ast;
+        
+        ExpressionCollector collector;
+        ast.getBody()->acceptRecursive(collector);
+        
+        double bestTree = 0;
+        double bestFlatten = 0;
+        double bestFlat = 0;
+        int totalKnownTree = 0;
+        int totalKnownFlat = 0;
+        FlatExpressions exprs;
+        
+        for(int i = 0; i < TOTAL_RUNS; ++i)
+        {
+            auto startTime = std::chrono::steady_clock::now();
+            
+            TreeFolder folder;
+            for(ExpressionNode* root : collector.roots)
+                folder.fold(root);
+                
+            totalKnownTree = folder.totalKnown;
+            
+            auto flattenTime = std::chrono::steady_clock::now();
+            
+            exprs.clear();
+            for(ExpressionNode* root : collector.roots)
+                exprs.add(root);
+                
+            auto flatTime = std::chrono::steady_clock::now();
+            
+            exprs.foldConstants();
+            
+            totalKnownFlat = 0;
+            for(int j = 0; j < exprs.size(); ++j)
+                totalKnownFlat += exprs.known[j];
+                
+            auto endTime = std::chrono::steady_clock::now();
+            
+            double treeTime = getMilliseconds(startTime, flattenTime);
+            double flattenTime_ = getMilliseconds(flattenTime, flatTime);
+            double flatTime_ = getMilliseconds(flatTime, endTime);
+            
+            if(i == 0 || treeTime < bestTree)
+                bestTree = treeTime;
+            if(i == 0 || flattenTime_ < bestFlatten)
+                bestFlatten = flattenTime_;
+            if(i == 0 || flatTime_ < bestFlat)
+                bestFlat = flatTime_;
+        }
+        
+        printf("Folding: %d expressions, %d nodes, %d constant (%d flat)\n", (int)collector.roots.size(), exprs.size(), totalKnownTree, totalKnownFlat);
+        printf("Folding trees: %.3f ms (%.1f M nodes/s)\n", bestTree, exprs.size() / bestTree / 1000);
+        printf("Folding flat: %.3f ms (%.1f M nodes/s), flattening %.3f ms\n", bestFlat, exprs.size() / bestFlat / 1000, bestFlatten);
+    }
+    
+private:
+    // Finds the root of every expression in the program
+    struct ExpressionCollector : AstVisitor
+    {
+        void visit(LetStatementNode* node) { roots.push_back(node->rightSide); }
+        void visit(IfNode* node) { roots.push_back(node->condition); }
+        void visit(PrintNode* node) { roots.push_back(node->value); }
+        
+        std::vector<ExpressionNode*> roots;
+    };
+    
+    // Folds each node of an expression tree, the same way as
+    // FlatExpressions::foldConstants
+    struct TreeFolder : AstVisitor
+    {
+        TreeFolder() : totalKnown(0) { }
+        
+        void fold(ExpressionNode* root)
+        {
+            root->acceptRecursive(*this);
+            values.clear();
+        }
+        
+        void visit(ExpressionNode* node)
+        {
+            int value = 0;
+            push(node->tryEvaluate(value), value);
+        }
+        
+        // Lists are visited before their indices, so they're folded once
+        // all of their indices have been
+        void visit(OneDimensionalListFactor* node) { addList(1); }
+        void visit(TwoDimensionalListFactor* node) { addList(2); }
+        void visit(ThreeDimensionalListFactor* node) { addList(3); }
+        void visit(PhiNode* node) { visit((ExpressionNode*)node); }
+        
+        void addList(int totalIndices)
+        {
+            lists.push_back(std::make_pair((int)values.size(), (int)values.size() + totalIndices));
+        }
+        
+        void visit(BinaryOpNode* node)
+        {
+            Value b = values.back();
+            values.pop_back();
+            Value a = values.back();
+            values.pop_back();
+            
+            int value = 0;
+            push(a.known && b.known && BinaryOpNode::evaluate(node->op, a.value, b.value, value), value);
+        }
+        
+        void visit(UnaryOpNode* node)
+        {
+            Value a = values.back();
+            values.pop_back();
+            
+            int value = 0;
+            push(a.known && UnaryOpNode::evaluate(node->op, a.value, value), value);
+        }
+        
+        void push(bool known, int value)
+        {
+            Value v = { known, value };
+            values.push_back(v);
+            totalKnown += known;
+            
+            // With the last index of a list in, the list's value replaces them
+            while(lists.size() != 0 && lists.back().second == (int)values.size())
+            {
+                values.resize(lists.back().first);
+                lists.pop_back();
+                
+                Value list = { false, 0 };
+                values.push_back(list);
+            }
+        }
+        
+        struct Value
+        {
+            bool known;
+            int value;
+        };
+        
+        std::vector<Value> values;
+        std::vector<std::pair<int, int>> lists;     // Where the indices of a list begin and end on values
+        int totalKnown;
+    };
+};
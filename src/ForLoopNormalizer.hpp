@@ -8,7 +8,7 @@ class ForLoopNormalizer : AstVisitor
 public:
     ForLoopNormalizer(ForLoopNode* forNode_, Ast& ast_) : forNode(forNode_), ast(ast_)
     {
-        auto varLValue = dynamic_cast<IntLValueNode*>(forNode->var);
+        auto varLValue = dyn_cast<IntLValueNode>(forNode->var);
         if(!varLValue)
             return;
         
@@ -16,16 +16,8 @@ public:
         
         int upper, lower, stride;
         
-        try
-        {
-            lower = forNode->lowerBound->tryEvaluate();
-            upper = forNode->upperBound->tryEvaluate();
-            stride = forNode->increment->tryEvaluate();
-        }
-        catch(...)
-        {
+        if(!forNode->lowerBound->tryEvaluate(lower) || !forNode->upperBound->tryEvaluate(upper) || !forNode->increment->tryEvaluate(stride))
             return;
-        }
         
         bool normalized = true;
         
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+// A set of dense ids (statement ids, SSA value ids) stored as a bitset. It
+// grows to fit the largest id inserted, so analyses don't need to know how many
+// nodes the AST has created. Clearing keeps the storage for the next run.
+class IdSet
+{
+public:
+    bool contains(int id) const
+    {
+        return id < (int)bits.size() && bits[id];
+    }
+    
+    // Returns false if the id was already in the set
+    bool insert(int id)
+    {
+        if(id >= (int)bits.size())
+            bits.resize(std::max(id + 1, (int)bits.size() * 2), false);
+            
+        if(bits[id])
+            return false;
+            
+        bits[id] = true;
+        return true;
+    }
+    
+    void clear()
+    {
+        std::fill(bits.begin(), bits.end(), false);
+    }
+    
+private:
+    std::vector<bool> bits;
+};
@@ -1,11 +1,10 @@
 #pragma once
 
-#include <set>
+#include <vector>
 
 #include "Ast.hpp"
 #include "AstVisitor.hpp"
-
-#include <typeinfo>
+#include "IdSet.hpp"
 
 class IoStatementFinder : AstVisitor
 {
@@ -13,10 +12,12 @@ public:
     IoStatementFinder(CodeBlockNode* programBody_) : programBody(programBody_)
         { visitLetBefore = true; }
     
-    std::set<StatementNode*> findIoStatements()
+    // The statements are returned in program order
+    const std::vector<StatementNode*>& findIoStatements()
     {
         currentStatement = nullptr;
         ioStatements.clear();
+        foundStatements.clear();
         programBody->acceptRecursive(*this);
         return ioStatements;
     }
@@ -24,32 +25,32 @@ public:
 private:
     void visit(PromptNode* node)
     {
-        ioStatements.insert(node);
+        addStatement(node);
     }
     
     void visit(PrintNode* node)
     {
-        ioStatements.insert(node);
+        addStatement(node);
     }
     
     void visit(InputNode* node)
     {
-        ioStatements.insert(node);
+        addStatement(node);
     }
     
     void visit(IfNode* node)
     {
-        ioStatements.insert(node);
+        addStatement(node);
     }
     
     void visit(GotoNode* node)
     {
-        ioStatements.insert(node);
+        addStatement(node);
     }
     
     void visit(EndNode* node)
     {
-        ioStatements.insert(node);
+        addStatement(node);
     }
     
     void visit(StatementNode* node)
@@ -97,11 +98,18 @@ private:
         if(!currentStatement)
             return;
         
-        ioStatements.insert(currentStatement);
+        addStatement(currentStatement);
+    }
+    
+    void addStatement(StatementNode* node)
+    {
+        if(foundStatements.insert(node->statementId))
+            ioStatements.push_back(node);
     }
     
     CodeBlockNode* programBody;
-    std::set<StatementNode*> ioStatements;
+    std::vector<StatementNode*> ioStatements;
+    IdSet foundStatements;
     StatementNode* currentStatement;
 };
 
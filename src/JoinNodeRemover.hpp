@@ -1,32 +1,25 @@
 #pragma once
 
 #include "Ast.hpp"
-#include "AstVisitor.hpp"
 
-class JoinNodeRemover : AstVisitor
+class JoinNodeRemover
 {
 public:
-    JoinNodeRemover(CodeBlockNode* programBody_, SsaIntLValueNode* nodeToRemove_)
-        : programBody(programBody_), nodeToRemove(nodeToRemove_) { }
+    JoinNodeRemover(SsaIntLValueNode* nodeToRemove_)
+        : nodeToRemove(nodeToRemove_) { }
         
     bool removeFromJoinNodes()
     {
-        success = false;
-        programBody->acceptRecursive(*this);
+        bool success = false;
+        
+        for(PhiNode* phi : nodeToRemove->phiUses)
+            success |= phi->joinNodes.erase(nodeToRemove) != 0;
+            
+        nodeToRemove->phiUses.clear();
+        
         return success;
     }
     
 private:
-    void visit(PhiNode* node)
-    {
-        if(node->joinNodes.count(nodeToRemove) == 0)
-            return;
-        
-        node->joinNodes.erase(nodeToRemove);
-        success = true;
-    }
-    
-    CodeBlockNode* programBody;
     SsaIntLValueNode* nodeToRemove;
-    bool success;
 };
@@ -1,24 +1,32 @@
-#include <cctype>
 #include <stdexcept>
 #include <iostream>
 
 #include "Lexer.hpp"
 #include "Error.hpp"
+#include "CharScanner.hpp"
 
-Lexer::Lexer(std::string inputString_)
-    : inputString(inputString_),
-    currentLine(1),
-    currentCol(1)
+Lexer::Lexer(const char* begin_, const char* end_, SymbolTable& symbols_)
+    : token(nullptr),
+    symbols(&symbols_),
+    sourceBegin(begin_),
+    begin(begin_),
+    end(end_)
 {
-    begin = &inputString[0];
-    end = &inputString[inputString.length()];
 }
 
-std::vector<Token>& Lexer::lexTokens()
+Lexer::Lexer(const char* sourceBegin_, const char* begin_, const char* end_)
+    : token(nullptr),
+    symbols(nullptr),
+    sourceBegin(sourceBegin_),
+    begin(begin_),
+    end(end_)
 {
-    while(lexNextToken()) ;
-    
-    return tokens;
+}
+
+bool Lexer::nextToken(Token& token_)
+{
+    token = &token_;
+    return lexNextToken();
 }
 
 void Lexer::addToken(const char* tokenEnd, TokenType type)
@@ -26,32 +34,23 @@ void Lexer::addToken(const char* tokenEnd, TokenType type)
     if(type == TOK_INVALID)
         throwErrorAtCurrentLocation("Programmer error: bad token type");
     
-    tokens.push_back(Token(type, std::string(begin, tokenEnd), currentLine, currentCol));
+    *token = Token(type, begin, tokenEnd - begin, getCurrentOffset());
     advanceTo(tokenEnd);
 }
 
 Token& Lexer::getLastToken()
 {
-    if(tokens.size() == 0)
-        throw "Trying to get last token when no tokens have been lexed yet";
-    
-    return tokens[tokens.size() - 1];
+    return *token;
 }
 
 void Lexer::advanceTo(const char* advancePos)
 {
-    while(begin < advancePos)
-    {
-        ++currentCol;
-        
-        if(*begin == '\n')
-        {
-            ++currentLine;
-            currentCol = 1;
-        }
-        
-        ++begin;
-    }
+    begin = advancePos;
+}
+
+int Lexer::getCurrentOffset()
+{
+    return begin - sourceBegin;
 }
 
 bool Lexer::lexNextToken()
@@ -82,21 +81,15 @@ bool Lexer::lexNextToken()
 
 void Lexer::consumeWhitespace()
 {
-    while(*begin == ' ' || *begin == '\t' || *begin == '\n' || *begin == '\r')
-        advanceTo(begin + 1);    
+    advanceTo(CharScanner::skipWhitespace(begin, end));
 }
 
 bool Lexer::lexNumber()
 {
-    if(!isdigit(*begin))
+    if(!CharScanner::isDigit(*begin))
         return false;
     
-    const char* tokenEnd = begin;
-    
-    do
-    {
-        ++tokenEnd;
-    } while(isdigit(*tokenEnd));
+    const char* tokenEnd = CharScanner::skipDigits(begin + 1, end);
     
     addToken(tokenEnd, TOK_NUMBER);
     
@@ -105,15 +98,10 @@ bool Lexer::lexNumber()
 
 bool Lexer::lexId()
 {
-    if(!isalpha(*begin) && *begin != '_')
+    if(!CharScanner::isAlpha(*begin) && *begin != '_')
         return false;
     
-    const char* tokenEnd = begin;
-    
-    do
-    {
-        ++tokenEnd;
-    } while(isalpha(*tokenEnd) || isdigit(*tokenEnd) || *tokenEnd == '_');
+    const char* tokenEnd = CharScanner::skipIdentifierChars(begin + 1, end);
     
     addToken(tokenEnd, TOK_ID);
     
@@ -123,10 +111,12 @@ bool Lexer::lexId()
 void Lexer::changeLastTokenTypeIfKeyword()
 {
     Token& lastToken = getLastToken();
-    TokenType keywordType = Token::getKeywordType(lastToken.value);
+    TokenType keywordType = Token::getKeywordType(lastToken.text, lastToken.length);
     
     if(keywordType != TOK_INVALID)
         lastToken.type = keywordType;
+    else if(symbols)
+        lastToken.symbol = symbols->intern(lastToken.text, lastToken.text + lastToken.length);
     
     if(keywordType == TOK_REM || keywordType == TOK_TITLE)
         lexComment();
@@ -137,12 +127,10 @@ void Lexer::lexComment()
     while(*begin == ' ' || *begin == '\t')
         advanceTo(begin + 1);
     
-    const char* tokenEnd = begin;
-    
-    while(tokenEnd < end && *tokenEnd != '\n')
-        ++tokenEnd;
+    const char* tokenEnd = CharScanner::findLineEnd(begin, end);
     
-    getLastToken().value = std::string(begin, tokenEnd);
+    getLastToken().text = begin;
+    getLastToken().length = tokenEnd - begin;
     advanceTo(tokenEnd);
 }
 
@@ -164,12 +152,11 @@ bool Lexer::lexComparisonOperator()
     if(*tokenEnd == '=')
         ++tokenEnd;
     
-    std::string op = std::string(begin, tokenEnd);
-    
-    if(op == "=")
+    // A single '=' is an assignment
+    if(*begin == '=' && tokenEnd - begin == 1)
         return false;
     
-    addToken(tokenEnd, Token::getOperatorType(op));
+    addToken(tokenEnd, Token::getOperatorType(begin, tokenEnd - begin));
     
     return true;
 }
@@ -179,8 +166,7 @@ bool Lexer::lexBracketOperator()
     if(*begin != '[' && *begin != ']' && *begin != '(' && *begin != ')' && *begin != ',')
         return false;
     
-    std::string op = std::string(begin, begin + 1);
-    addToken(begin + 1, Token::getOperatorType(op));
+    addToken(begin + 1, Token::getOperatorType(begin, 1));
     
     return true;
 }
@@ -190,7 +176,7 @@ bool Lexer::lexArithmeticOperator()
     if(*begin != '+' && *begin != '-' && *begin != '/' && *begin != '*' && *begin != '%')
         return false;
     
-    addToken(begin + 1, Token::getOperatorType(std::string(begin, begin + 1)));
+    addToken(begin + 1, Token::getOperatorType(begin, 1));
     
     return true;
 }
@@ -210,13 +196,7 @@ bool Lexer::lexString()
     if(*begin != '"')
         return false;
     
-    const char* tokenEnd = begin;
-    
-    do
-    {
-        ++tokenEnd;
-    }
-    while(tokenEnd < end && *tokenEnd != '\n' && *tokenEnd != '"');
+    const char* tokenEnd = CharScanner::findStringEnd(begin + 1, end);
     
     if(*tokenEnd != '"')
         throwErrorAtCurrentLocation("Unterminated '\"'");
@@ -228,6 +208,6 @@ bool Lexer::lexString()
 
 void Lexer::throwErrorAtCurrentLocation(std::string errorMessage)
 {
-    throw CompileError(errorMessage, "Lexing", currentLine, currentCol);
+    throw CompileError(errorMessage, "Lexing", getCurrentOffset());
 }
 
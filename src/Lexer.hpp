@@ -3,13 +3,24 @@
 #include <vector>
 
 #include "Token.hpp"
+#include "SymbolTable.hpp"
 
 class Lexer
 {
 public:
-    Lexer(std::string inputString_);
+    // Lexes [begin_, end_), which must be followed by a '\0'. The input isn't
+    // copied, so it has to outlive the tokens. Identifiers are interned into
+    // symbols.
+    Lexer(const char* begin_, const char* end_, SymbolTable& symbols_);
     
-    std::vector<Token>& lexTokens();
+    // Lexes [begin_, end_) out of a larger source starting at sourceBegin_,
+    // which the token offsets are relative to. The chunk has to end just
+    // after a newline (or at the end of the source). Identifiers are left
+    // for the caller to intern.
+    Lexer(const char* sourceBegin_, const char* begin_, const char* end_);
+    
+    // Lexes the next token into token. Returns false at the end of the input.
+    bool nextToken(Token& token_);
     
 private:
     void addToken(const char* tokenEnd, TokenType type);
@@ -32,17 +43,14 @@ private:
     
     bool lexString();
     
-    std::string currentLineAndColumn();
-    void printCurrentLine();
+    int getCurrentOffset();
     void throwErrorAtCurrentLocation(std::string errorMessage);
     
-    std::vector<Token> tokens;
-    std::string inputString;
+    Token* token;
+    SymbolTable* symbols;
     
+    const char* sourceBegin;
     const char* begin;
     const char* end;
-    
-    int currentLine;
-    int currentCol;
 };
 
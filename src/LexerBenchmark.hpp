@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdio>
+#include <chrono>
+#include <thread>
+
+#include "BenchmarkBase.hpp"
+#include "Lexer.hpp"
+#include "ParallelLexer.hpp"
+#include "SymbolTable.hpp"
+
+// Lexes the whole source, on one thread and on several
+class LexerBenchmark : BenchmarkBase
+{
+public:
+    LexerBenchmark(SourceBuffer& source_) : BenchmarkBase(source_) { }
+    
+    void run()
+    {
+        benchmarkLexer();
+        benchmarkParallelLexer();
+    }
+    
+private:
+    void benchmarkLexer()
+    {
+        double best = 0;
+        int totalTokens = 0;
+        int totalSymbols = 0;
+        
+        for(int i = 0; i < TOTAL_RUNS; ++i)
+        {
+            auto startTime = std::chrono::steady_clock::now();
+            
+            SymbolTable symbols;
+            Lexer lexer(source.begin(), source.end(), symbols);
+            Token token(TOK_INVALID, "", 0, -1);
+            
+            totalTokens = 0;
+            while(lexer.nextToken(token))
+                ++totalTokens;
+                
+            totalSymbols = symbols.getTotalSymbols();
+            
+            double time = getMilliseconds(startTime, std::chrono::steady_clock::now());
+            if(i == 0 || time < best)
+                best = time;
+        }
+        
+        printf("Lexer: %d bytes, %d tokens, %d symbols\n", (int)source.size(), totalTokens, totalSymbols);
+        printf("Lexer: %.3f ms (%.1f MB/s, %.1f M tokens/s)\n", best, source.size() / best / 1000, totalTokens / best / 1000);
+    }
+    
+    // Lexes with 1, 2, 4... threads up to the number of cores
+    void benchmarkParallelLexer()
+    {
+        int maxThreads = std::thread::hardware_concurrency();
+        if(maxThreads < 1)
+            maxThreads = 1;
+            
+            
+        for(int totalThreads = 1; ; totalThreads *= 2)
+        {
+            if(totalThreads > maxThreads)
+                totalThreads = maxThreads;
+                
+            double best = 0;
+            
+            for(int i = 0; i < TOTAL_RUNS; ++i)
+            {
+                auto startTime = std::chrono::steady_clock::now();
+                
+                SymbolTable symbols;
+                ParallelLexer lexer(source.begin(), source.end(), symbols, totalThreads);
+                Token token(TOK_INVALID, "", 0, -1);
+                
+                lexer.lexChunks();
+                while(lexer.nextToken(token)) { }
+                
+                double time = getMilliseconds(startTime, std::chrono::steady_clock::now());
+                if(i == 0 || time < best)
+                    best = time;
+            }
+            
+            printf("Parallel lexer, %d threads: %.3f ms (%.1f MB/s)\n", totalThreads, best, source.size() / best / 1000);
+            
+            if(totalThreads >= maxThreads)
+                break;
+        }
+    }
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+// Maps byte offsets into a source buffer to line and column numbers. Tokens
+// and nodes only store the offset they start at; the offset of the start of
+// each line is found once, after which any offset can be mapped with a binary
+// search. Lines and columns count from 1, and an offset of -1 means "nowhere".
+class LineIndex
+{
+public:
+    LineIndex() : begin(nullptr), end(nullptr) { }
+    
+    void build(const char* begin_, const char* end_)
+    {
+        begin = begin_;
+        end = end_;
+        
+        lineStarts.clear();
+        lineStarts.push_back(0);
+        
+        for(const char* p = begin; p < end; ++p)
+        {
+            p = (const char*)memchr(p, '\n', end - p);
+            if(!p)
+                break;
+                
+            lineStarts.push_back(p + 1 - begin);
+        }
+    }
+    
+    bool isBuilt() const
+    {
+        return lineStarts.size() != 0;
+    }
+    
+    int getLine(int offset) const
+    {
+        if(offset < 0)
+            return -1;
+            
+        return std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) - lineStarts.begin();
+    }
+    
+    int getColumn(int offset) const
+    {
+        if(offset < 0)
+            return -1;
+            
+        return offset - lineStarts[getLine(offset) - 1] + 1;
+    }
+    
+    // The text of a line, without the newline
+    const char* getLineBegin(int line) const
+    {
+        return begin + lineStarts[line - 1];
+    }
+    
+    const char* getLineEnd(int line) const
+    {
+        if(line < (int)lineStarts.size())
+            return begin + lineStarts[line] - 1;
+            
+        return end;
+    }
+    
+private:
+    const char* begin;
+    const char* end;
+    std::vector<int> lineStarts;
+};
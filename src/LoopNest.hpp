@@ -0,0 +1,189 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "DominatorTree.hpp"
+
+// The natural loops of the basic block graph and how they nest. Loops aren't
+// statements any more by the time the graph exists (the parser lowers them to
+// labels and gotos), so they're found again from the graph: every edge to a
+// block that dominates its source is a back edge, and the loop of a header is
+// the header plus every block that can reach one of its back edges without
+// going through the header. Loops sharing a header are merged. Irreducible
+// cycles have no header that dominates them and aren't reported as loops.
+//
+// Blocks are numbered the same way as in the DominatorTree the loops were
+// found in.
+class LoopNest
+{
+public:
+    struct Loop
+    {
+        Loop(int header_) : header(header_), parent(-1), depth(1), preheader(-1) { }
+        
+        int header;
+        int parent;                 // Innermost enclosing loop, or -1
+        int depth;                  // 1 for outermost loops
+        int preheader;              // See findPreheader(), -1 if there isn't one
+        std::vector<int> blocks;    // Sorted, including the header
+        std::vector<int> latches;   // Sources of the back edges
+    };
+    
+    LoopNest(DominatorTree& dominatorTree)
+    {
+        findLoops(dominatorTree);
+        buildNesting();
+        
+        for(Loop& loop : loops)
+            loop.preheader = findPreheader(dominatorTree, loop);
+    }
+    
+    const std::vector<Loop>& getLoops()
+    {
+        return loops;
+    }
+    
+    // Innermost loop containing the block, or -1
+    int getLoopOf(int block)
+    {
+        return innermostLoop[block];
+    }
+    
+    // Number of loops containing the block, 0 if it isn't in a loop
+    int getLoopDepth(int block)
+    {
+        return innermostLoop[block] == -1 ? 0 : loops[innermostLoop[block]].depth;
+    }
+    
+    int getMaxLoopDepth()
+    {
+        int maxDepth = 0;
+        for(const Loop& loop : loops)
+            maxDepth = std::max(maxDepth, loop.depth);
+            
+        return maxDepth;
+    }
+    
+private:
+    void findLoops(DominatorTree& dominatorTree)
+    {
+        int totalBlocks = dominatorTree.getTotalBlocks();
+        std::vector<int> loopOfHeader(totalBlocks, -1);
+        std::vector<int> inLoop(totalBlocks, -1);
+        std::vector<int> work;
+        
+        innermostLoop.assign(totalBlocks, -1);
+        
+        // Headers in reverse postorder, so outer loops come before the loops
+        // nested in them
+        for(int header : dominatorTree.getReversePostorder())
+        {
+            if(header == dominatorTree.getRoot())
+                continue;
+                
+            for(int predecessor : dominatorTree.getPredecessors(header))
+            {
+                if(predecessor == dominatorTree.getRoot() || !dominatorTree.dominates(header, predecessor))
+                    continue;
+                    
+                if(loopOfHeader[header] == -1)
+                {
+                    loopOfHeader[header] = loops.size();
+                    loops.push_back(Loop(header));
+                }
+                
+                loops[loopOfHeader[header]].latches.push_back(predecessor);
+            }
+        }
+        
+        for(int i = 0; i < (int)loops.size(); ++i)
+        {
+            Loop& loop = loops[i];
+            
+            inLoop[loop.header] = i;
+            loop.blocks.push_back(loop.header);
+            
+            for(int latch : loop.latches)
+            {
+                if(inLoop[latch] == i)
+                    continue;
+                    
+                inLoop[latch] = i;
+                loop.blocks.push_back(latch);
+                work.push_back(latch);
+            }
+            
+            while(work.size() != 0)
+            {
+                int block = work.back();
+                work.pop_back();
+                
+                for(int predecessor : dominatorTree.getPredecessors(block))
+                {
+                    if(predecessor == dominatorTree.getRoot() || inLoop[predecessor] == i)
+                        continue;
+                        
+                    inLoop[predecessor] = i;
+                    loop.blocks.push_back(predecessor);
+                    work.push_back(predecessor);
+                }
+            }
+            
+            std::sort(loop.blocks.begin(), loop.blocks.end());
+        }
+    }
+    
+    void buildNesting()
+    {
+        // An enclosing loop is always larger than the loops nested in it, so
+        // going from the largest loop down, the innermost loop seen so far for
+        // a header is the parent of its loop
+        std::vector<int> bySize(loops.size());
+        for(int i = 0; i < (int)loops.size(); ++i)
+            bySize[i] = i;
+            
+        std::stable_sort(bySize.begin(), bySize.end(), [this](int a, int b)
+        {
+            return loops[a].blocks.size() > loops[b].blocks.size();
+        });
+        
+        for(int i : bySize)
+        {
+            Loop& loop = loops[i];
+            
+            loop.parent = innermostLoop[loop.header];
+            loop.depth = loop.parent == -1 ? 1 : loops[loop.parent].depth + 1;
+            
+            for(int block : loop.blocks)
+                innermostLoop[block] = i;
+        }
+    }
+    
+    // The preheader is the only block entering the loop from outside, if that
+    // block always goes on to the header. Code hoisted out of the loop can go
+    // at the end of it.
+    int findPreheader(DominatorTree& dominatorTree, const Loop& loop)
+    {
+        int preheader = -1;
+        
+        for(int predecessor : dominatorTree.getPredecessors(loop.header))
+        {
+            if(std::binary_search(loop.blocks.begin(), loop.blocks.end(), predecessor))
+                continue;
+                
+            if(predecessor == dominatorTree.getRoot() || preheader != -1)
+                return -1;
+                
+            preheader = predecessor;
+        }
+        
+        if(preheader == -1 || dominatorTree.getSuccessors(preheader).size() != 1)
+            return -1;
+            
+        return preheader;
+    }
+    
+    std::vector<Loop> loops;
+    std::vector<int> innermostLoop;
+};
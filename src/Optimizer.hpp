@@ -1,9 +1,14 @@
 #pragma once
 
+#include <chrono>
+
 #include "Ast.hpp"
 #include "SsaBuilder.hpp"
-#include "PhiNodeBuilder.hpp"
-#include "ExpressionFolder.hpp"
+#include "DefUseBuilder.hpp"
+#include "CfgAnalysis.hpp"
+#include "CfgSimplifier.hpp"
+#include "OptimizerWorklist.hpp"
+#include "ConstantPropagator.hpp"
 #include "DeadCodeEliminator.hpp"
 #include "CopyPropagator.hpp"
 #include "RedundantVariableRemover.hpp"
@@ -14,7 +19,8 @@ public:
     Optimizer(CodeBlockNode* programBody_, Ast& ast_)
         : programBody(programBody_),
         ast(ast_),
-        expressionFolder(programBody, ast),
+        cfg(programBody),
+        constantPropagator(programBody, ast),
         eliminator(programBody),
         copyPropagator(programBody, ast),
         varRemover(programBody)
@@ -22,44 +28,77 @@ public:
         
     void optimize()
     {
+        auto startTime = std::chrono::steady_clock::now();
+        
         SsaBuilder ssaBuilder(programBody, ast);
-        ssaBuilder.buildSsa();
+        ssaBuilder.buildSsa(cfg.getDominatorTree());
+        
+        DefUseBuilder defUseBuilder;
+        defUseBuilder.buildDefUseChains(programBody);
         
-        PhiNodeBuilder phiNodeBuilder(programBody, ast);
-        phiNodeBuilder.buildPhiNodes();
+        auto ssaTime = std::chrono::steady_clock::now();
+        
+        OptimizerWorklist worklist(programBody, cfg);
         
         int iterationCount = 1;
-        while(optimizeIteration())
+        while(optimizeIteration(worklist))
             ++iterationCount;
+            
+        // The ifs and blocks killed above leave empty blocks and jumps
+        // around them behind
+        CfgSimplifier cfgSimplifier(programBody, ast);
+        cfgSimplifier.simplify();
+        cfg.invalidate();
         
         ast.eliminateUnusedVars();
         
+        auto endTime = std::chrono::steady_clock::now();
+        
+        LoopNest& loops = cfg.getLoopNest();
+        
         printf("============Optimizer stats============\n");
         printf("Total optimization passes: %d\n", iterationCount);
-        expressionFolder.printStats();
+        worklist.printStats();
+        constantPropagator.printStats();
         eliminator.printStats();
         copyPropagator.printStats();
         varRemover.printStats();
+        cfgSimplifier.printStats();
+        printf("Phi nodes inserted: %d\n", ssaBuilder.getTotalPhiNodes());
+        printf("Loops: %d (max nesting depth %d)\n", (int)loops.getLoops().size(), loops.getMaxLoopDepth());
+        printf("Dominator tree builds: %d\n", cfg.getTotalBuilds());
+        printf("SSA construction time: %.2f ms\n", getMilliseconds(startTime, ssaTime));
+        printf("Optimization time: %.2f ms\n", getMilliseconds(ssaTime, endTime));
         printf("=======================================\n");
     }
     
 private:
-    bool optimizeIteration()
+    bool optimizeIteration(OptimizerWorklist& worklist)
     {
         bool success = false;
         
-        success |= expressionFolder.foldExpressions();
-        success |= eliminator.eliminateDeadCode();
-        success |= copyPropagator.propagateCopies();
-        success |= varRemover.removeRedundantVariables();
+        success |= constantPropagator.propagateConstants(worklist);
+        success |= eliminator.eliminateDeadCode(worklist);
+        success |= copyPropagator.propagateCopies(worklist);
+        success |= varRemover.removeRedundantVariables(worklist);
+        
+        // Statements killed this round only get in the way of the next one
+        // and of everything after the optimizer
+        worklist.removeDeadStatements(programBody);
         
         return success;
     }
     
+    double getMilliseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+    {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+    
     
     CodeBlockNode* programBody;
     Ast& ast;
-    ExpressionFolder expressionFolder;
+    CfgAnalysis cfg;
+    ConstantPropagator constantPropagator;
     DeadCodeEliminator eliminator;
     CopyPropagator copyPropagator;
     RedundantVariableRemover varRemover;
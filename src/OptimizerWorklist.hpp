@@ -0,0 +1,652 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+
+#include "Ast.hpp"
+#include "AstVisitor.hpp"
+#include "CfgAnalysis.hpp"
+#include "IdSet.hpp"
+
+// Keeps track of the statements and SSA values each optimization pass still
+// has to look at, so a pass only re-examines what was affected by earlier
+// changes instead of sweeping the whole program again.
+//
+// Pending statements are handed out in program order and pending values in
+// order of their ssaId, so a pass run over its worklist makes exactly the same
+// changes as a full sweep, and the same changes on every run.
+// When something changes, the affected work is scheduled for the running
+// pass if the pass hasn't reached it yet and for its next run otherwise.
+class OptimizerWorklist : AstVisitor
+{
+public:
+    enum StatementPass
+    {
+        CONSTANT_PASS,
+        COPY_PASS,
+        TOTAL_STATEMENT_PASSES
+    };
+    
+    OptimizerWorklist(CodeBlockNode* programBody, CfgAnalysis& cfg_)
+        : cfg(cfg_),
+        activePass(TOTAL_STATEMENT_PASSES),
+        activePosition(-1),
+        activeIndex(0),
+        valuePassActive(false),
+        activeValue(nullptr),
+        needsDce(true),
+        totalDceRuns(0),
+        totalValuesExamined(0),
+        totalStatementsRemoved(0)
+    {
+        int totalStatements = 0;
+        for(auto s : programBody->statements)
+            totalStatements += cast<BasicBlockNode>(s)->statements.size();
+            
+        positions.reserve(totalStatements);
+        
+        for(auto s : programBody->statements)
+        {
+            BasicBlockNode* block = cast<BasicBlockNode>(s);
+            
+            for(int i = 0; i < (int)block->statements.size(); ++i)
+                addStatement(block, i);
+        }
+        
+        isQueued.resize(positions.size(), false);
+        
+        for(int i = 0; i < TOTAL_STATEMENT_PASSES; ++i)
+        {
+            totalStatementsExamined[i] = 0;
+            isPending[i].resize(positions.size(), true);
+            
+            for(int j = 0; j < (int)positions.size(); ++j)
+                pending[i].push_back(j);
+        }
+    }
+    
+    // Statement passes
+    
+    void beginStatementPass(StatementPass pass)
+    {
+        activePass = pass;
+        activePosition = -1;
+        active.clear();
+        active.swap(pending[pass]);
+        activeIndex = 0;
+        addedWork.clear();
+        
+        for(int position : active)
+        {
+            isPending[pass][position] = false;
+            isQueued[position] = true;
+        }
+        
+        std::sort(active.begin(), active.end());
+    }
+    
+    bool nextStatement(int& position)
+    {
+        while(activeIndex < (int)active.size() || addedWork.size() != 0)
+        {
+            int next;
+            
+            if(addedWork.size() != 0 && (activeIndex == (int)active.size() || addedWork.front() < active[activeIndex]))
+            {
+                std::pop_heap(addedWork.begin(), addedWork.end(), std::greater<int>());
+                next = addedWork.back();
+                addedWork.pop_back();
+            }
+            else
+            {
+                next = active[activeIndex++];
+            }
+            
+            isQueued[next] = false;
+            activePosition = next;
+            
+            if(isDead(activePosition))
+                continue;
+                
+            ++totalStatementsExamined[activePass];
+            position = activePosition;
+            return true;
+        }
+        
+        activePass = TOTAL_STATEMENT_PASSES;
+        return false;
+    }
+    
+    bool hasPendingStatements(StatementPass pass)
+    {
+        return pending[pass].size() != 0;
+    }
+    
+    StatementNode* getStatement(int position)
+    {
+        return positions[position].block->statements[positions[position].index];
+    }
+    
+    BasicBlockNode* getBlock(int position)
+    {
+        return positions[position].block;
+    }
+    
+    // Runs a visitor over a single top level statement, allowing it to replace
+    // the statement the same way BasicBlockNode::acceptRecursive does
+    void visitStatement(int position, AstVisitor& v)
+    {
+        StatementNode*& node = positions[position].block->statements[positions[position].index];
+        
+        v.enterNode(node);
+        node->acceptRecursive(v);
+        StatementNode* oldNode = node;
+        node = cast<StatementNode>(v.lastNode());
+        v.exitNode(node);
+        
+        node->programOrder = position;
+        
+        // The old statement may still be listed as a user of some value, and
+        // scheduling it schedules whatever replaced it
+        if(node != oldNode)
+            replacedStatements.push_back(oldNode);
+    }
+    
+    // Value pass (RedundantVariableRemover)
+    
+    void beginValuePass()
+    {
+        valuePassActive = true;
+        activeValue = nullptr;
+        activeValues.clear();
+        activeValues.swap(pendingValues);
+        
+        std::make_heap(activeValues.begin(), activeValues.end(), isLaterValue);
+    }
+    
+    bool nextValue(SsaIntLValueNode*& value)
+    {
+        while(activeValues.size() != 0)
+        {
+            std::pop_heap(activeValues.begin(), activeValues.end(), isLaterValue);
+            SsaIntLValueNode* next = activeValues.back();
+            activeValues.pop_back();
+            
+            // Skip duplicates
+            if(activeValue && !isLaterValue(next, activeValue))
+                continue;
+                
+            activeValue = next;
+            
+            if(!isLive(activeValue->definitionNode))
+                continue;
+                
+            ++totalValuesExamined;
+            value = activeValue;
+            return true;
+        }
+        
+        valuePassActive = false;
+        return false;
+    }
+    
+    int getLiveDefinitionCount(IntDeclNode* var)
+    {
+        return var->varId < (int)liveDefinitions.size() ? liveDefinitions[var->varId] : 0;
+    }
+    
+    // Dead code elimination is still a whole program analysis, so it's only
+    // rerun when the program has changed in a way that could kill something
+    
+    bool needsDeadCodeElimination()
+    {
+        return needsDce;
+    }
+    
+    void deadCodeEliminated(bool killedBlocks)
+    {
+        // Values of a variable that's down to a single definition, and
+        // anything computed from them, may now be replaceable
+        for(int varId : changedVars)
+        {
+            if(liveDefinitions[varId] > 1)
+                continue;
+                
+            for(SsaIntLValueNode* def : definitions[varId])
+            {
+                scheduleValue(def);
+                
+                for(StatementNode* user : def->users)
+                {
+                    if(SsaIntLValueNode* userValue = getDefinedValue(user))
+                        scheduleValue(userValue);
+                }
+            }
+        }
+        
+        changedVars.clear();
+        isChangedVar.clear();
+        
+        // Statements kept alive only by a block that was just killed will be
+        // found dead by the next run
+        needsDce = killedBlocks;
+        ++totalDceRuns;
+        
+        if(killedBlocks)
+            cfg.invalidate();
+    }
+    
+    // Analyses of the basic block graph, kept up to date as blocks are killed
+    CfgAnalysis& getCfg()
+    {
+        return cfg;
+    }
+    
+    // SSA values are emitted under the name of their variable, so a use can
+    // only be rewritten to another value of var if no live definition of var
+    // can run between the statement at position and the use. Returns true if
+    // one can run before user is reached from position.
+    bool isRedefinedBefore(IntDeclNode* var, int position, StatementNode* user)
+    {
+        if(user->programOrder == -1 || isDead(user->programOrder) || var->varId >= (int)definitions.size())
+            return false;
+            
+        BasicBlockNode* startBlock = getBlock(position);
+        int startIndex = positions[position].index;
+        BasicBlockNode* userBlock = getBlock(user->programOrder);
+        int userIndex = positions[user->programOrder].index;
+        
+        // Straight-line code within the block
+        if(userBlock == startBlock && userIndex > startIndex)
+            return hasDefinitionBetween(var, startBlock, startIndex, userIndex);
+            
+        if(hasDefinitionBetween(var, startBlock, startIndex, startBlock->statements.size()))
+            return true;
+            
+        // A path from the start block to a block it dominates that doesn't go
+        // through the start block again never leaves the blocks it dominates,
+        // so only definitions in those can get in the way. Killing blocks only
+        // removes paths, so this holds even if the tree is out of date.
+        DominatorTree& dominatorTree = cfg.getDominatorTree();
+        bool dominatesUser = dominatorTree.dominates(startBlock->id, userBlock->id);
+        bool hasCandidates = false;
+        definitionBlocks.clear();
+        
+        for(SsaIntLValueNode* def : definitions[var->varId])
+        {
+            if(!isLive(def->definitionNode))
+                continue;
+                
+            BasicBlockNode* block = getBlock(def->definitionNode->programOrder);
+            definitionBlocks.insert(block->id);
+            hasCandidates |= !dominatesUser || dominatorTree.dominates(startBlock->id, block->id);
+        }
+        
+        if(!hasCandidates)
+            return false;
+            
+        // Search the blocks reachable from the end of the start block, once
+        // for each of whether a definition has been passed on the way. Getting
+        // back to the start block runs the statement at position again.
+        std::vector<std::pair<BasicBlockNode*, bool>> work;
+        reachedClean.clear();
+        reachedRedefined.clear();
+        
+        for(BasicBlockNode* successor : startBlock->successors)
+            work.push_back(std::make_pair(successor, false));
+            
+        while(work.size() != 0)
+        {
+            BasicBlockNode* block = work.back().first;
+            bool redefined = work.back().second;
+            work.pop_back();
+            
+            if(block->markedAsDead || !(redefined ? reachedRedefined : reachedClean).insert(block->id))
+                continue;
+                
+            if(block == userBlock)
+            {
+                if(redefined || hasDefinitionBetween(var, block, -1, userIndex))
+                    return true;
+                    
+                continue;
+            }
+            
+            if(block == startBlock)
+                continue;
+                
+            redefined |= definitionBlocks.contains(block->id);
+            
+            for(BasicBlockNode* successor : block->successors)
+                work.push_back(std::make_pair(successor, redefined));
+        }
+        
+        return false;
+    }
+    
+    // Compaction
+    
+    // Drops dead statements from their basic blocks, so the remaining passes
+    // and the code generator don't keep stepping over them, and renumbers the
+    // positions of the statements that are left. Removed statements get a
+    // position of -1, so they're never scheduled again. Only call this between
+    // passes. Returns how many statements were removed.
+    //
+    // The removed statements and their subtrees stay in the Ast's arena until
+    // the Ast is gone, since stale def-use entries and shared expressions may
+    // still point at them. Only the blocks' statement vectors shrink.
+    int removeDeadStatements(CodeBlockNode* programBody)
+    {
+        std::vector<StatementPosition> oldPositions;
+        oldPositions.swap(positions);
+        
+        std::vector<int> newPositions(oldPositions.size(), -1);
+        
+        for(auto s : programBody->statements)
+        {
+            BasicBlockNode* block = cast<BasicBlockNode>(s);
+            int totalKept = 0;
+            
+            for(StatementNode* node : block->statements)
+            {
+                if(block->markedAsDead || node->markedAsDead)
+                {
+                    node->programOrder = -1;
+                    continue;
+                }
+                
+                StatementPosition position;
+                position.block = block;
+                position.index = totalKept;
+                
+                newPositions[node->programOrder] = positions.size();
+                positions.push_back(position);
+                
+                block->statements[totalKept++] = node;
+            }
+            
+            block->statements.resize(totalKept);
+            
+            // Give back the space of blocks that lost most of their statements
+            if(block->statements.capacity() > 2 * block->statements.size())
+                block->statements.shrink_to_fit();
+        }
+        
+        // Statements that were replaced still point at the position of their
+        // replacement, and the ones whose replacement was removed can be
+        // forgotten
+        std::sort(replacedStatements.begin(), replacedStatements.end());
+        replacedStatements.erase(std::unique(replacedStatements.begin(), replacedStatements.end()), replacedStatements.end());
+        
+        int totalReplaced = 0;
+        for(StatementNode* node : replacedStatements)
+        {
+            if(node->programOrder != -1)
+                node->programOrder = newPositions[node->programOrder];
+                
+            if(node->programOrder != -1)
+                replacedStatements[totalReplaced++] = node;
+        }
+        
+        replacedStatements.resize(totalReplaced);
+        
+        for(int i = 0; i < (int)positions.size(); ++i)
+            getStatement(i)->programOrder = i;
+            
+        int totalRemoved = oldPositions.size() - positions.size();
+        
+        // Positions only move down, so the pending lists stay in order
+        for(int i = 0; i < TOTAL_STATEMENT_PASSES; ++i)
+        {
+            std::vector<int> remapped;
+            for(int position : pending[i])
+            {
+                if(newPositions[position] != -1)
+                    remapped.push_back(newPositions[position]);
+            }
+            
+            pending[i].swap(remapped);
+            
+            isPending[i].assign(positions.size(), false);
+            for(int position : pending[i])
+                isPending[i][position] = true;
+        }
+        
+        isQueued.assign(positions.size(), false);
+        totalStatementsRemoved += totalRemoved;
+        
+        return totalRemoved;
+    }
+    
+    // Change notifications
+    
+    void statementChanged(StatementNode* node)
+    {
+        needsDce = true;
+        scheduleStatement(node);
+    }
+    
+    void valueBecameConstant(SsaIntLValueNode* value)
+    {
+        for(StatementNode* user : value->users)
+            scheduleStatement(user);
+    }
+    
+    // Called after node has been inserted into a statement
+    void usesAdded(ExpressionNode* node)
+    {
+        node->acceptRecursive(*this);
+    }
+    
+    void variableReplaced(ExpressionNode* replacement, const std::vector<StatementNode*>& changedStatements)
+    {
+        for(StatementNode* s : changedStatements)
+        {
+            statementChanged(s);
+            usesAdded(replacement);
+        }
+    }
+    
+    void statementKilled(StatementNode* node)
+    {
+        SsaIntLValueNode* lValue = getDefinedValue(node);
+        if(!lValue)
+            return;
+            
+        // Any phi nodes that used the value have lost an operand
+        for(StatementNode* user : lValue->users)
+            scheduleStatement(user);
+            
+        int varId = lValue->var->varId;
+        --liveDefinitions[varId];
+        
+        if(isChangedVar.insert(varId))
+            changedVars.push_back(varId);
+    }
+    
+    void printStats()
+    {
+        printf("Statements examined by constant propagator: %d\n", totalStatementsExamined[CONSTANT_PASS]);
+        printf("Statements examined by copy propagator: %d\n", totalStatementsExamined[COPY_PASS]);
+        printf("Variables examined by redundant var remover: %d\n", totalValuesExamined);
+        printf("Dead code elimination runs: %d\n", totalDceRuns);
+        printf("Dead statements removed: %d\n", totalStatementsRemoved);
+    }
+    
+private:
+    struct StatementPosition
+    {
+        BasicBlockNode* block;
+        int index;
+    };
+    
+    void addStatement(BasicBlockNode* block, int index)
+    {
+        StatementPosition position;
+        position.block = block;
+        position.index = index;
+        
+        StatementNode* node = block->statements[index];
+        node->programOrder = positions.size();
+        positions.push_back(position);
+        
+        SsaIntLValueNode* lValue = getDefinedValue(node);
+        if(!lValue)
+            return;
+            
+        int varId = lValue->var->varId;
+        if(varId >= (int)definitions.size())
+        {
+            definitions.resize(varId + 1);
+            liveDefinitions.resize(varId + 1, 0);
+        }
+        
+        definitions[varId].push_back(lValue);
+        
+        if(!isDead(node->programOrder))
+        {
+            ++liveDefinitions[varId];
+            pendingValues.push_back(lValue);
+        }
+    }
+    
+    bool isDead(int position)
+    {
+        return positions[position].block->markedAsDead || getStatement(position)->markedAsDead;
+    }
+    
+    bool isLive(StatementNode* node)
+    {
+        return node->programOrder != -1 && !isDead(node->programOrder) && getStatement(node->programOrder) == node;
+    }
+    
+    // Whether a live definition of var sits in block strictly between the
+    // statement indices from and to
+    bool hasDefinitionBetween(IntDeclNode* var, BasicBlockNode* block, int from, int to)
+    {
+        if(var->varId >= (int)definitions.size())
+            return false;
+            
+        for(SsaIntLValueNode* def : definitions[var->varId])
+        {
+            if(!isLive(def->definitionNode))
+                continue;
+                
+            StatementPosition& position = positions[def->definitionNode->programOrder];
+            if(position.block == block && position.index > from && position.index < to)
+                return true;
+        }
+        
+        return false;
+    }
+    
+    SsaIntLValueNode* getDefinedValue(StatementNode* node)
+    {
+        if(LetStatementNode* let = dyn_cast<LetStatementNode>(node))
+            return dyn_cast<SsaIntLValueNode>(let->leftSide);
+            
+        return nullptr;
+    }
+    
+    void scheduleStatement(StatementNode* node)
+    {
+        if(node->programOrder == -1)
+            return;
+            
+        for(int i = 0; i < TOTAL_STATEMENT_PASSES; ++i)
+            scheduleStatement(i, node->programOrder);
+            
+        if(SsaIntLValueNode* lValue = getDefinedValue(node))
+            scheduleValue(lValue);
+    }
+    
+    void scheduleStatement(int pass, int position)
+    {
+        if(pass == activePass && position > activePosition)
+        {
+            if(isQueued[position])
+                return;
+                
+            isQueued[position] = true;
+            addedWork.push_back(position);
+            std::push_heap(addedWork.begin(), addedWork.end(), std::greater<int>());
+        }
+        else if(!isPending[pass][position])
+        {
+            isPending[pass][position] = true;
+            pending[pass].push_back(position);
+        }
+    }
+    
+    void scheduleValue(SsaIntLValueNode* value)
+    {
+        if(valuePassActive && (!activeValue || isLaterValue(value, activeValue)))
+        {
+            activeValues.push_back(value);
+            std::push_heap(activeValues.begin(), activeValues.end(), isLaterValue);
+        }
+        else
+        {
+            pendingValues.push_back(value);
+        }
+    }
+    
+    // Orders the value heap so the value with the lowest ssaId is on top
+    static bool isLaterValue(const SsaIntLValueNode* a, const SsaIntLValueNode* b)
+    {
+        return a->ssaId > b->ssaId;
+    }
+    
+    void visit(SsaIntVarFactor* node)
+    {
+        // A new use may give a copy or a single definition variable something
+        // to replace
+        scheduleValue(node->ssaLValue);
+        
+        int position = node->ssaLValue->definitionNode->programOrder;
+        if(position != -1)
+            scheduleStatement(COPY_PASS, position);
+    }
+    
+    CfgAnalysis& cfg;
+    std::vector<StatementPosition> positions;
+    std::vector<StatementNode*> replacedStatements;
+    
+    // Indexed by varId
+    std::vector<std::vector<SsaIntLValueNode*>> definitions;
+    std::vector<int> liveDefinitions;
+    
+    // Blocks reached by isRedefinedBefore, and the blocks holding a live
+    // definition of the variable it was asked about
+    IdSet reachedClean;
+    IdSet reachedRedefined;
+    IdSet definitionBlocks;
+    
+    // Variables that lost a definition since dead code was last eliminated
+    std::vector<int> changedVars;
+    IdSet isChangedVar;
+    
+    // Pending work for the next run of each pass. The running pass walks its
+    // sorted work list, merging in a min-heap of work added along the way.
+    std::vector<int> pending[TOTAL_STATEMENT_PASSES];
+    std::vector<bool> isPending[TOTAL_STATEMENT_PASSES];
+    std::vector<int> active;
+    std::vector<int> addedWork;
+    std::vector<bool> isQueued;
+    int activePass;
+    int activePosition;
+    int activeIndex;
+    
+    std::vector<SsaIntLValueNode*> pendingValues;
+    std::vector<SsaIntLValueNode*> activeValues;
+    bool valuePassActive;
+    SsaIntLValueNode* activeValue;
+    
+    bool needsDce;
+    int totalDceRuns;
+    int totalStatementsExamined[TOTAL_STATEMENT_PASSES];
+    int totalValuesExamined;
+    int totalStatementsRemoved;
+};
@@ -0,0 +1,110 @@
+#include <thread>
+#include <atomic>
+#include <cstring>
+#include <cstddef>
+
+#include "ParallelLexer.hpp"
+#include "Lexer.hpp"
+
+ParallelLexer::ParallelLexer(const char* begin_, const char* end_, SymbolTable& symbols_, int totalThreads_)
+    : begin(begin_),
+    end(end_),
+    symbols(symbols_),
+    totalThreads(totalThreads_ < 1 ? 1 : totalThreads_),
+    currentChunk(0),
+    currentToken(0)
+{
+}
+
+void ParallelLexer::lexChunks()
+{
+    splitIntoChunks();
+    currentChunk = 0;
+    currentToken = 0;
+    
+    std::atomic<int> nextChunk(0);
+    
+    auto worker = [&]()
+    {
+        for(int i = nextChunk++; i < (int)chunks.size(); i = nextChunk++)
+            lexChunk(chunks[i]);
+    };
+    
+    std::vector<std::thread> threads;
+    for(int i = 1; i < totalThreads; ++i)
+        threads.push_back(std::thread(worker));
+        
+    worker();
+    
+    for(std::thread& thread : threads)
+        thread.join();
+}
+
+bool ParallelLexer::nextToken(Token& token)
+{
+    while(currentChunk < chunks.size())
+    {
+        Chunk& chunk = chunks[currentChunk];
+        
+        if(currentToken < chunk.tokens.size())
+        {
+            token = chunk.tokens[currentToken++];
+            
+            if(token.type == TOK_ID)
+                token.symbol = symbols.intern(token.text, token.text + token.length);
+                
+            return true;
+        }
+        
+        if(chunk.error)
+            std::rethrow_exception(chunk.error);
+            
+        // Done with this chunk, so its tokens can go
+        std::vector<Token>().swap(chunk.tokens);
+        
+        ++currentChunk;
+        currentToken = 0;
+    }
+    
+    return false;
+}
+
+void ParallelLexer::splitIntoChunks()
+{
+    chunks.clear();
+    
+    size_t totalChunks = totalThreads * CHUNKS_PER_THREAD;
+    size_t chunkSize = (end - begin) / totalChunks;
+    
+    if(chunkSize < MIN_CHUNK_SIZE)
+        chunkSize = MIN_CHUNK_SIZE;
+        
+    const char* chunkBegin = begin;
+    
+    while(end - chunkBegin > (ptrdiff_t)chunkSize)
+    {
+        const char* newline = (const char*)memchr(chunkBegin + chunkSize, '\n', end - chunkBegin - chunkSize);
+        if(!newline)
+            break;
+            
+        chunks.push_back(Chunk(chunkBegin, newline + 1));
+        chunkBegin = newline + 1;
+    }
+    
+    chunks.push_back(Chunk(chunkBegin, end));
+}
+
+void ParallelLexer::lexChunk(Chunk& chunk)
+{
+    try
+    {
+        Lexer lexer(begin, chunk.begin, chunk.end);
+        Token token(TOK_INVALID, "", 0, -1);
+        while(lexer.nextToken(token))
+            chunk.tokens.push_back(token);
+    }
+    catch(...)
+    {
+        chunk.error = std::current_exception();
+    }
+}
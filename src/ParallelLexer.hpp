@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <exception>
+
+#include "Token.hpp"
+#include "SymbolTable.hpp"
+
+// Lexes a large source on several threads. The source is cut into chunks at
+// newlines, which always fall between tokens since neither strings nor
+// rem/title comments can span lines, and each chunk is lexed on its own.
+// Tokens are then handed out in order with nextToken(), just like a Lexer
+// would, interning identifiers as they go so the symbols are numbered exactly
+// as they would be by a single Lexer.
+//
+// A chunk that fails to lex keeps the tokens before the error, and the error
+// is rethrown once they've been handed out, so errors are reported just as
+// they would be when lexing serially.
+class ParallelLexer
+{
+public:
+    ParallelLexer(const char* begin_, const char* end_, SymbolTable& symbols_, int totalThreads_);
+    
+    void lexChunks();
+    
+    // Returns the next token, or false at the end of the input. Only valid
+    // after lexChunks().
+    bool nextToken(Token& token);
+    
+private:
+    struct Chunk
+    {
+        Chunk(const char* begin_, const char* end_) : begin(begin_), end(end_) { }
+        
+        const char* begin;
+        const char* end;
+        std::vector<Token> tokens;
+        std::exception_ptr error;
+    };
+    
+    // Splitting a small source costs more than it saves
+    static const int MIN_CHUNK_SIZE = 64 * 1024;
+    
+    // More chunks than threads, so a thread that finishes early can pick up
+    // another
+    static const int CHUNKS_PER_THREAD = 4;
+    
+    void splitIntoChunks();
+    void lexChunk(Chunk& chunk);
+    
+    const char* begin;
+    const char* end;
+    SymbolTable& symbols;
+    int totalThreads;
+    std::vector<Chunk> chunks;
+    size_t currentChunk;
+    size_t currentToken;
+};
@@ -6,10 +6,11 @@
 #include "ForLoopNormalizer.hpp"
 #include "Polynomial.hpp"
 
-Parser::Parser(std::vector<Token>& tokens_)
+Parser::Parser(TokenStream& tokens_, SymbolTable& symbols)
     : tokens(&tokens_),
     currentTokenId(0),
-    lastToken(Token(TOK_INVALID, "", -1, -1)),
+    lastToken(Token(TOK_INVALID, "", 0, -1)),
+    ast(symbols),
     nextLabelId(0)
 {
     
@@ -44,17 +45,17 @@ ExpressionNode* Parser::Parser::parseExpression()
 
 FactorNode* Parser::parseVarFactor()
 {
-    VarDeclNode* var = ast.getVarByName(currentToken().value);
+    VarDeclNode* var = ast.getVarByName(currentToken().symbol);
     FactorNode* newNode = NULL;
     
-    std::string name = currentToken().value;
-    
     if(!var)
-        throwErrorAtCurrentLocation("No such variable " + name);
+        throwErrorAtCurrentLocation("No such variable " + currentToken().getValue());
+    
+    const std::string& name = var->name;
     
     bool arrayAccess = peekNextToken().type == TOK_LSQUARE_BRACKET;
     
-    if(IntDeclNode* intVar = dynamic_cast<IntDeclNode*>(var))
+    if(IntDeclNode* intVar = dyn_cast<IntDeclNode>(var))
     {
         if(arrayAccess)
             throwErrorAtCurrentLocation("Variable " + name + " does not have list type");
@@ -62,7 +63,7 @@ FactorNode* Parser::parseVarFactor()
         newNode = ast.addIntVarFactor(intVar);
         nextToken();
     }
-    else if(OneDimensionalListDecl* listVar = dynamic_cast<OneDimensionalListDecl*>(var))
+    else if(OneDimensionalListDecl* listVar = dyn_cast<OneDimensionalListDecl>(var))
     {
         if(!arrayAccess)
             throwErrorAtCurrentLocation("Variable " + name + " has array type - expected '['");
@@ -78,7 +79,7 @@ FactorNode* Parser::parseVarFactor()
         
         newNode = ast.addOneDimensionalListFactor(listVar, index);
     }
-    else if(TwoDimensionalListDecl* listVar = dynamic_cast<TwoDimensionalListDecl*>(var))
+    else if(TwoDimensionalListDecl* listVar = dyn_cast<TwoDimensionalListDecl>(var))
     {
         if(!arrayAccess)
             throwErrorAtCurrentLocation("Variable " + name + " has array type - expected '['");
@@ -99,7 +100,7 @@ FactorNode* Parser::parseVarFactor()
         
         newNode = ast.addTwoDimensionalListFactor(listVar, index0, index1);
     }
-    else if(ThreeDimensionalListDecl* listVar = dynamic_cast<ThreeDimensionalListDecl*>(var))
+    else if(ThreeDimensionalListDecl* listVar = dyn_cast<ThreeDimensionalListDecl>(var))
     {
         if(!arrayAccess)
             throwErrorAtCurrentLocation("Variable " + name + " has array type - expected '['");
@@ -147,7 +148,7 @@ ExpressionNode* Parser::parseFactor()
     
     if(currentToken().type == TOK_NUMBER)
     {
-        newNode = ast.newIntegerNode(atoi(currentToken().value.c_str()));
+        newNode = ast.newIntegerNode(currentToken().getIntValue());
         nextToken();
     }
     else if(currentToken().type == TOK_ID)
@@ -187,7 +188,7 @@ ExpressionNode* Parser::parseTerm()
 
 void Parser::throwErrorAtCurrentLocation(std::string errorMessage)
 {
-    throw CompileError(errorMessage, "Parsing", currentToken().line, currentToken().col);
+    throw CompileError(errorMessage, "Parsing", currentToken().offset);
 }
 
 bool Parser::parseVarDecl()
@@ -196,7 +197,7 @@ bool Parser::parseVarDecl()
     {
         nextToken();
         expectType(TOK_ID);
-        ast.addIntegerVar(currentToken().value, currentToken().line, currentToken().col);
+        ast.addIntegerVar(currentToken().symbol, currentToken().offset);
         nextToken();
         return true;
     }
@@ -208,7 +209,7 @@ bool Parser::parseVarDecl()
         nextToken();
         
         expectType(TOK_NUMBER);        
-        int totalElements = atoi(currentToken().value.c_str());
+        int totalElements = currentToken().getIntValue();
         nextToken();
         
         expectType(TOK_RSQUARE_BRACKET);
@@ -216,7 +217,7 @@ bool Parser::parseVarDecl()
         
         expectType(TOK_ID);
         
-        ast.add1DListVar(currentToken().value, currentToken().line, currentToken().col, totalElements);
+        ast.add1DListVar(currentToken().symbol, currentToken().offset, totalElements);
         nextToken();
         
         return true;
@@ -229,19 +230,19 @@ bool Parser::parseVarDecl()
         nextToken();
         
         expectType(TOK_NUMBER);        
-        int totalElements0 = atoi(currentToken().value.c_str());
+        int totalElements0 = currentToken().getIntValue();
         nextToken();
         
         expectType(TOK_COMMA);
         nextToken();
         expectType(TOK_NUMBER);        
-        int totalElements1 = atoi(currentToken().value.c_str());
+        int totalElements1 = currentToken().getIntValue();
         nextToken();
         
         expectType(TOK_COMMA);
         nextToken();
         expectType(TOK_NUMBER);        
-        int totalElements2 = atoi(currentToken().value.c_str());
+        int totalElements2 = currentToken().getIntValue();
         nextToken();
         
         expectType(TOK_RSQUARE_BRACKET);
@@ -249,7 +250,7 @@ bool Parser::parseVarDecl()
         
         expectType(TOK_ID);
         
-        ast.add3DListVar(currentToken().value, currentToken().line, currentToken().col, totalElements0, totalElements1, totalElements2);
+        ast.add3DListVar(currentToken().symbol, currentToken().offset, totalElements0, totalElements1, totalElements2);
         nextToken();
         
         return true;
@@ -262,13 +263,13 @@ bool Parser::parseVarDecl()
         nextToken();
         
         expectType(TOK_NUMBER);        
-        int totalElements0 = atoi(currentToken().value.c_str());
+        int totalElements0 = currentToken().getIntValue();
         nextToken();
         
         expectType(TOK_COMMA);
         nextToken();
         expectType(TOK_NUMBER);        
-        int totalElements1 = atoi(currentToken().value.c_str());
+        int totalElements1 = currentToken().getIntValue();
         nextToken();
         
         expectType(TOK_RSQUARE_BRACKET);
@@ -276,7 +277,7 @@ bool Parser::parseVarDecl()
         
         expectType(TOK_ID);
         
-        ast.add2DListVar(currentToken().value, currentToken().line, currentToken().col, totalElements0, totalElements1);
+        ast.add2DListVar(currentToken().symbol, currentToken().offset, totalElements0, totalElements1);
         nextToken();
         
         return true;
@@ -301,7 +302,7 @@ void Parser::parseHeader()
         }
         else if(currentToken().type == TOK_TITLE)
         {
-            ast.setTitle(currentToken().value);
+            ast.setTitle(currentToken().getValue());
             nextToken();
         }
         else if(currentToken().type == TOK_REM)
@@ -310,7 +311,7 @@ void Parser::parseHeader()
         }
         else
         {
-            throwErrorAtCurrentLocation("Unexpected token: " + currentToken().value);
+            throwErrorAtCurrentLocation("Unexpected token: " + currentToken().getValue());
         }
     } while(true);
 }
@@ -343,7 +344,7 @@ StatementNode* Parser::parseStatement()
 
 RemNode* Parser::parseComment()
 {    
-    RemNode* node = ast.addRemNode(currentToken().value);
+    RemNode* node = ast.addRemNode(currentToken().getValue());
     nextToken();
     return node;
 }
@@ -353,15 +354,16 @@ LValueNode* Parser::parseLValue()
 {
     expectType(TOK_ID);
     
-    std::string name = currentToken().value;
-    VarDeclNode* var = ast.getVarByName(name);
+    VarDeclNode* var = ast.getVarByName(currentToken().symbol);
     
     if(!var)
-        throwErrorAtCurrentLocation("No such variable " + name);
+        throwErrorAtCurrentLocation("No such variable " + currentToken().getValue());
+    
+    const std::string& name = var->name;
     
     bool arrayAccess = peekNextToken().type == TOK_LSQUARE_BRACKET;
     
-    if(IntDeclNode* intVar = dynamic_cast<IntDeclNode*>(var))
+    if(IntDeclNode* intVar = dyn_cast<IntDeclNode>(var))
     {
         if(arrayAccess)
             throwErrorAtCurrentLocation("Variable " + name + " does not have list type");
@@ -370,7 +372,7 @@ LValueNode* Parser::parseLValue()
         return ast.addIntLValue(intVar);
     }
     
-    if(OneDimensionalListDecl* listVar = dynamic_cast<OneDimensionalListDecl*>(var))
+    if(OneDimensionalListDecl* listVar = dyn_cast<OneDimensionalListDecl>(var))
     {
         if(!arrayAccess)
             throwErrorAtCurrentLocation("Variable " + name + " has array type - expected '['");
@@ -387,7 +389,7 @@ LValueNode* Parser::parseLValue()
         return ast.addOneDimensionalListLValueNode(listVar, index);
     }
     
-    if(TwoDimensionalListDecl* listVar = dynamic_cast<TwoDimensionalListDecl*>(var))
+    if(TwoDimensionalListDecl* listVar = dyn_cast<TwoDimensionalListDecl>(var))
     {
         if(!arrayAccess)
             throwErrorAtCurrentLocation("Variable " + name + " has array type - expected '['");
@@ -409,7 +411,7 @@ LValueNode* Parser::parseLValue()
         return ast.addTwoDimensionalListLValueNode(listVar, index0, index1);
     }
     
-    if(ThreeDimensionalListDecl* listVar = dynamic_cast<ThreeDimensionalListDecl*>(var))
+    if(ThreeDimensionalListDecl* listVar = dyn_cast<ThreeDimensionalListDecl>(var))
     {
         if(!arrayAccess)
             throwErrorAtCurrentLocation("Variable " + name + " has array type - expected '['");
@@ -529,9 +531,7 @@ GotoNode* Parser::parseGoto()
     nextToken();
     expectType(TOK_ID);
     
-    std::string name = currentToken().value;
-    
-    GotoNode* newNode = ast.addGotoNode(name, currentToken().line, currentToken().col);
+    GotoNode* newNode = ast.addGotoNode(currentToken().symbol, currentToken().offset);
     nextToken();
     
     return newNode;
@@ -542,13 +542,11 @@ LabelNode* Parser::parseLabel()
     nextToken();
     expectType(TOK_ID);
     
-    std::string name = currentToken().value;
-    
     LabelNode* newNode;
     
     try
     {
-        newNode = ast.addLabelNode(name, currentToken().line, currentToken().col);
+        newNode = ast.addLabelNode(currentToken().symbol, currentToken().offset);
         nextToken();
     }
     catch(std::string error)
@@ -591,7 +589,7 @@ StatementNode* Parser::parseIf()
     
     StatementNode* body = parseStatement();
     
-    if(dynamic_cast<RemNode*>(body))
+    if(dyn_cast<RemNode>(body))
     {
         prevToken();
         throwErrorAtCurrentLocation("Comment inside of if body leading to invalid code (comments are considered statements)");
@@ -599,7 +597,7 @@ StatementNode* Parser::parseIf()
     
     IfNode* ifNode = ast.addIfNode(condition, body);
     
-    if(!dynamic_cast<GotoNode*>(body))
+    if(!dyn_cast<GotoNode>(body))
     {
         printf("WARNING: if node contains something other than goto\n");
         
@@ -612,8 +610,8 @@ StatementNode* Parser::parseIf()
             codeBlock->addStatement(ifNode->body);
             codeBlock->addStatement(skipLabel);
             
-            ifNode->invertCondition();
-            ifNode->body = ast.addGotoNode(skipLabel->name, -1, -1);
+            ifNode->invertCondition(ast);
+            ifNode->body = ast.addGotoNode(skipLabel->symbol, -1);
             
             printf("\tAutomatically fixed\n");
             
@@ -633,7 +631,7 @@ PromptNode* Parser::parsePrompt()
     nextToken();
     expectType(TOK_STRING);
     
-    std::string value = currentToken().value;
+    std::string value = currentToken().getValue();
     nextToken();
     
     return ast.addPromptNode(value);
@@ -703,7 +701,7 @@ CodeBlockNode* Parser::transformForLoop(ForLoopNode* node)
                 TOK_LE,
                 node->upperBound
             ),
-            ast.addGotoNode(loopLabel->name, -1, -1)
+            ast.addGotoNode(loopLabel->symbol, -1)
         )
     );
     
@@ -718,7 +716,7 @@ CodeBlockNode* Parser::transformWhileLoop(WhileLoopNode* node)
     LabelNode* loopConditionLabel = generateTempLabel();
     LabelNode* loopContinueLabel = generateTempLabel();
     
-    block->addStatement(ast.addGotoNode(loopConditionLabel->name, -1, -1));
+    block->addStatement(ast.addGotoNode(loopConditionLabel->symbol, -1));
     block->addStatement(loopContinueLabel);
     
     node->body->disableCurlyBraces();
@@ -731,7 +729,7 @@ CodeBlockNode* Parser::transformWhileLoop(WhileLoopNode* node)
         ast.addIfNode
         (
             node->condition,
-            ast.addGotoNode(loopContinueLabel->name, -1, -1)
+            ast.addGotoNode(loopContinueLabel->symbol, -1)
         )
     );
     
@@ -741,12 +739,15 @@ CodeBlockNode* Parser::transformWhileLoop(WhileLoopNode* node)
 
 CodeBlockNode* Parser::parseString(std::string str)
 {
-    Lexer lexer(str);
-    auto newTokens = lexer.lexTokens();
+    Lexer lexer(str.c_str(), str.c_str() + str.length(), ast.getSymbols());
+    TokenStream newTokens(lexer);
     
     int saveCurrentTokenId = currentTokenId;
     auto saveTokens = tokens;
     
+    tokens = &newTokens;
+    currentTokenId = 0;
+    
     CodeBlockNode* newBlock = parseCodeBlock(TOK_END);
     
     currentTokenId = saveCurrentTokenId;
@@ -3,19 +3,20 @@
 #include <vector>
 
 #include "Token.hpp"
+#include "TokenStream.hpp"
 #include "Ast.hpp"
 
 class Parser
 {
 public:
-    Parser(std::vector<Token>& tokens_);
+    Parser(TokenStream& tokens_, SymbolTable& symbols);
     Ast& parse();
     
 private:
     Token& currentToken()
     {
-        if(currentTokenId < (int)tokens->size())
-            return (*tokens)[currentTokenId];
+        if(Token* token = tokens->getToken(currentTokenId))
+            return *token;
 
         return lastToken;
     }
@@ -33,7 +34,7 @@ private:
     {
         // TODO: name the tokens and print what was expected
         if(currentToken().type != expectedType)
-            throwErrorAtCurrentLocation("Expected \"" + Token::getTokenName(expectedType) + "\" (found \"" + currentToken().value + "\")");
+            throwErrorAtCurrentLocation("Expected \"" + Token::getTokenName(expectedType) + "\" (found \"" + currentToken().getValue() + "\")");
     }
                 
     void nextToken()
@@ -43,7 +44,7 @@ private:
     
     LabelNode* generateTempLabel()
     {
-        return ast.addLabelNode("L_" + std::to_string(nextLabelId++), -1, -1);
+        return ast.addLabelNode(ast.getSymbols().intern("L_" + std::to_string(nextLabelId++)), -1);
     }
     
     void prevToken() { if(currentTokenId > 0) --currentTokenId; }
@@ -82,7 +83,7 @@ private:
     
     void throwErrorAtCurrentLocation(std::string errorMessage);
 
-    std::vector<Token>* tokens;
+    TokenStream* tokens;
     int currentTokenId;
     Token lastToken;
     Ast ast;
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdio>
+
+#include "BenchmarkBase.hpp"
+#include "SsaBuilder.hpp"
+#include "DefUseBuilder.hpp"
+#include "VariableUsageCounter.hpp"
+#include "IoStatementFinder.hpp"
+
+// Times the whole program passes that only read the program
+class PassBenchmark : BenchmarkBase
+{
+public:
+    PassBenchmark(SourceBuffer& source_) : BenchmarkBase(source_) { }
+    
+    // Runs the whole program passes that only read the program over it in SSA
+    // form, as the optimizer would
+    void run()
+    {
+        auto parsed = parseSource();
+        Ast& ast = parsed->ast;
+        
+        ast.defaultInitializeVars();
+        ast.splitIntoBasicBlocks();
+        
+        CodeBlockNode* programBody = ast.getBody();
+        SsaBuilder ssaBuilder(programBody, ast);
+        ssaBuilder.buildSsa();
+        
+        DefUseBuilder defUseBuilder;
+        double bestDefUse = bestTime([&]() { defUseBuilder.buildDefUseChains(programBody); });
+        
+        VariableUsageCounter counter(programBody, true);
+        double bestCounter = bestTime([&]() { counter.countVarUses(); });
+        
+        IoStatementFinder finder(programBody);
+        double bestFinder = bestTime([&]() { finder.findIoStatements(); });
+        
+        printf("DefUseBuilder: %.3f ms\n", bestDefUse);
+        printf("VariableUsageCounter: %.3f ms\n", bestCounter);
+        printf("IoStatementFinder: %.3f ms\n", bestFinder);
+    }
+};
@@ -37,24 +37,25 @@ struct Polynomial
         return res;
     }
     
-    Polynomial mul(Polynomial& p)
+    // Returns false if the product isn't linear
+    bool mul(Polynomial& p, Polynomial& res)
     {
         if(!onlyConstant() && !p.onlyConstant())
-            throw "Bad polynomial mul";
+            return false;
         
         if(p.onlyConstant())
         {
-            Polynomial res = *this;
+            res = *this;
             for(auto c : coeff)
             {
                 res.coeff[c.first] *= p.coeff["constant"];
             }
             
             
-            return res;
+            return true;
         }
         else
-            return p.mul(*this);
+            return p.mul(*this, res);
     }
     
     Polynomial neg()
@@ -9,18 +9,27 @@
 class PolynomialBuilder : AstVisitor
 {
 public:
-    Polynomial toPolynomial(ExpressionNode* node)
+    // Returns false if the expression isn't a linear polynomial
+    bool toPolynomial(ExpressionNode* node, Polynomial& result)
     {
+        stack = std::stack<Polynomial>();
+        failed = false;
+        
         node->acceptRecursive(*this);
         
-        if(stack.size() != 1)
-            throw "Bad poly stack";
+        if(failed || stack.size() != 1)
+            return false;
         
-        return popPoly();
+        result = popPoly();
+        return true;
     }
     
 private:
-    void visit(AstNode* node) { throw "Bad node"; }
+    void visit(AstNode* node) { failed = true; }
+    void visit(ExpressionNode* node) { failed = true; }
+    void visit(OneDimensionalListFactor* node) { failed = true; }
+    void visit(TwoDimensionalListFactor* node) { failed = true; }
+    void visit(ThreeDimensionalListFactor* node) { failed = true; }
     
     
     void visit(IntegerNode* node)
@@ -50,19 +59,32 @@ private:
     
     void visit(BinaryOpNode* node)
     {
+        if(failed || stack.size() < 2)
+        {
+            failed = true;
+            return;
+        }
+        
         Polynomial b = popPoly();
         Polynomial a = popPoly();
+        Polynomial res(0);
         
         if(node->op == TOK_ADD) { pushPoly(a.add(b)); return; }
         if(node->op == TOK_SUB) { pushPoly(a.sub(b)); return; }
-        if(node->op == TOK_MUL) { pushPoly(a.mul(b)); return; }
-        if(node->op == TOK_DIV) throw "Bad polynomial division";
+        if(node->op == TOK_MUL && a.mul(b, res)) { pushPoly(res); return; }
         
-        throw "Bad polynomial op";
+        // Division, comparisons and non-linear products
+        failed = true;
     }
     
     void visit(UnaryOpNode* node)
     {
+        if(failed || stack.size() == 0)
+        {
+            failed = true;
+            return;
+        }
+        
         if(node->op == TOK_ADD)
         {
             pushPoly(popPoly());
@@ -74,7 +96,7 @@ private:
             return;
         }
         
-        throw "Bad polynomial op";
+        failed = true;
     }
     
     void pushPoly(Polynomial p)
@@ -84,13 +106,11 @@ private:
     
     Polynomial popPoly()
     {
-        if(stack.size() == 0)
-            throw "Emply poly stack";
-        
         Polynomial top = stack.top();
         stack.pop();
         return top;
     }
     
     std::stack<Polynomial> stack;
+    bool failed;
 };
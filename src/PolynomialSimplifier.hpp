@@ -15,15 +15,28 @@ public:
 private:
     void visit(ExpressionNode* node)
     {
-        try
+        // An operand's polynomial is built along with its operator's, and
+        // building it again for every operand of a chain of n additions
+        // would build n polynomials of up to n terms
+        if(isOperand())
+            return;
+            
+        PolynomialBuilder builder;
+        Polynomial p(0);
+        
+        if(builder.toPolynomial(node, p))
         {
-            PolynomialBuilder builder;
-            Polynomial p = builder.toPolynomial(node);
             //replaceNode(ast.addPolynomialNode(p));
         }
-        catch(...)
-        {
-        }
+    }
+    
+    bool isOperand()
+    {
+        if(nodeStack.size() < 2)
+            return false;
+            
+        AstNode* parent = nodeStack[nodeStack.size() - 2];
+        return isa<BinaryOpNode>(parent) || isa<UnaryOpNode>(parent);
     }
     
     Ast& ast;
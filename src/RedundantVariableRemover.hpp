@@ -3,44 +3,40 @@
 #include "Ast.hpp"
 #include "AstVisitor.hpp"
 #include "VariableReplacer.hpp"
-#include "VariableUsageCounter.hpp"
+#include "OptimizerWorklist.hpp"
 
 class RedundantVariableRemover : AstVisitor
 {
 public:
     RedundantVariableRemover(CodeBlockNode* programBody_) : programBody(programBody_), totalRemoved(0) { }
     
-    bool removeRedundantVariables()
+    bool removeRedundantVariables(OptimizerWorklist& worklist_)
     {
-        VariableUsageCounter counter(programBody, true, false, false);
-        auto count = counter.countVarUses();
+        worklist = &worklist_;
         bool success = false;
         
-        declNodes.clear();
+        SsaIntLValueNode* var;
+        worklist->beginValuePass();
         
-        for(auto var : count)
+        while(worklist->nextValue(var))
         {
-            declNodes[var.first->var] += var.second;
-        }
-        
-        for(auto var : count)
-        {
-            bool inputNode = dynamic_cast<InputIntNode*>(var.first->definitionNode->rightSide);
+            bool inputNode = isa<InputIntNode>(var->definitionNode->rightSide);
             
             // Only one definition of var
-            if(declNodes[var.first->var] == 1 && !inputNode)
+            if(worklist->getLiveDefinitionCount(var->var) == 1 && !inputNode)
             {
                 hasAllSingleDefVariables = true;
-                var.first->definitionNode->rightSide->acceptRecursive(*this);
+                var->definitionNode->rightSide->acceptRecursive(*this);
                 
                 if(!hasAllSingleDefVariables)
                     continue;
                 
-                VariableReplacer replacer(programBody, var.first, var.first->definitionNode->rightSide);
+                VariableReplacer replacer(var, var->definitionNode->rightSide);
                 bool worked = replacer.replaceVars();
                 
                 if(worked)
                 {
+                    worklist->variableReplaced(var->definitionNode->rightSide, replacer.getChangedStatements());
                     ++totalRemoved;
                     success = true;
                 }
@@ -58,7 +54,7 @@ public:
 private:
     void visit(SsaIntVarFactor* node)
     {
-        if(declNodes[node->var] > 1)
+        if(worklist->getLiveDefinitionCount(node->var) > 1)
             hasAllSingleDefVariables = false;
     }
     
@@ -80,8 +76,8 @@ private:
         hasAllSingleDefVariables = false;
     }
     
-    std::map<IntDeclNode*, int> declNodes;
     CodeBlockNode* programBody;
+    OptimizerWorklist* worklist;
     int totalRemoved;
     bool hasAllSingleDefVariables;
 };
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+// A set of dense ids stored as the nonzero 64-bit words of a bitvector, sorted
+// by word index. Sets of ids that are close together take a word or two no
+// matter how large the ids get, and a union works on whole words at a time
+// instead of on single elements.
+class SparseBitVector
+{
+public:
+    // Returns false if the id was already in the set
+    bool insert(int id)
+    {
+        int index = id / 64;
+        uint64_t bit = (uint64_t)1 << (id % 64);
+        
+        auto it = words.end();
+        while(it != words.begin() && (it - 1)->index >= index)
+            --it;
+            
+        if(it != words.end() && it->index == index)
+        {
+            if(it->bits & bit)
+                return false;
+                
+            it->bits |= bit;
+            return true;
+        }
+        
+        words.insert(it, Word(index, bit));
+        return true;
+    }
+    
+    // Adds every id in v, and returns whether any of them were new
+    bool unionWith(const SparseBitVector& v)
+    {
+        std::vector<Word> merged;
+        merged.reserve(words.size() + v.words.size());
+        
+        bool changed = false;
+        auto a = words.begin();
+        auto b = v.words.begin();
+        
+        while(a != words.end() || b != v.words.end())
+        {
+            if(b == v.words.end() || (a != words.end() && a->index < b->index))
+            {
+                merged.push_back(*a++);
+            }
+            else if(a == words.end() || b->index < a->index)
+            {
+                merged.push_back(*b++);
+                changed = true;
+            }
+            else
+            {
+                changed |= (b->bits & ~a->bits) != 0;
+                merged.push_back(Word(a->index, a->bits | b->bits));
+                ++a;
+                ++b;
+            }
+        }
+        
+        if(changed)
+            words.swap(merged);
+            
+        return changed;
+    }
+    
+    int count() const
+    {
+        int total = 0;
+        for(const Word& word : words)
+            total += __builtin_popcountll(word.bits);
+            
+        return total;
+    }
+    
+    // The smallest id in the set, or -1 if it's empty
+    int first() const
+    {
+        if(words.size() == 0)
+            return -1;
+            
+        return words[0].index * 64 + __builtin_ctzll(words[0].bits);
+    }
+    
+    // Calls f with each id in the set, in increasing order
+    template<typename Function>
+    void forEach(Function f) const
+    {
+        for(const Word& word : words)
+        {
+            for(uint64_t bits = word.bits; bits != 0; bits &= bits - 1)
+                f(word.index * 64 + __builtin_ctzll(bits));
+        }
+    }
+    
+private:
+    struct Word
+    {
+        Word(int index_, uint64_t bits_) : index(index_), bits(bits_) { }
+        
+        int index;
+        uint64_t bits;
+    };
+    
+    std::vector<Word> words;
+};
@@ -1,14 +1,28 @@
 #pragma once
 
-#include <queue>
+#include <set>
+#include <vector>
+#include <algorithm>
 
 #include "Ast.hpp"
 #include "AstVisitor.hpp"
+#include "DominatorTree.hpp"
+#include "SparseBitVector.hpp"
 
+// Puts the program into SSA form: every assignment to an int variable gets its
+// own SsaIntLValueNode, every read becomes an SsaIntVarFactor of the value
+// that reaches it and phi nodes join the values where control flow merges.
+//
+// Phi nodes are placed at the iterated dominance frontier of a variable's
+// definitions (Cytron et al.), but only in blocks where the variable is live,
+// and variables are then renamed with a walk over the dominator tree. The
+// optimizer expects the operands of a phi node to be the definitions that
+// actually reach it, so phi nodes are flattened afterwards and the ones that
+// only ever see a single definition are left out.
 class SsaBuilder : AstVisitor
 {
 public:
-    SsaBuilder(CodeBlockNode* programBody_, Ast& ast_) : programBody(programBody_), ast(ast_)
+    SsaBuilder(CodeBlockNode* programBody_, Ast& ast_) : programBody(programBody_), ast(ast_), totalUses(0), totalPhiNodes(0)
     {
     }
     
@@ -16,63 +30,411 @@ public:
     {
         for(StatementNode* s : programBody->statements)
         {
-            auto block = dynamic_cast<BasicBlockNode*>(s);
-            if(!block)
-                throw CompileError("Ssa block contains object other than basic block", "SSA building", -1, -1);
-            
-            workQueue.push(block);
+            if(!isa<BasicBlockNode>(s))
+                throw CompileError("Ssa block contains object other than basic block", "SSA building", -1);
         }
         
-        while(!workQueue.empty())
+        DominatorTree dominatorTree(programBody);
+        buildSsa(dominatorTree);
+    }
+    
+    // Same as above, with a dominator tree of the program that has already
+    // been built (see CfgAnalysis). SSA construction doesn't change the graph,
+    // so the tree stays valid.
+    void buildSsa(DominatorTree& dominatorTree)
+    {
+        findDefsAndUses();
+        placePhiNodes(dominatorTree);
+        renameVars(dominatorTree);
+        flattenPhiNodes();
+        insertPhiNodes();
+        replaceUses();
+    }
+    
+    int getTotalPhiNodes()
+    {
+        return totalPhiNodes;
+    }
+    
+private:
+    // A value reaching a use: a definition, a phi node or nothing at all
+    struct SsaValue
+    {
+        SsaValue(SsaIntLValueNode* def_, int phi_) : def(def_), phi(phi_) { }
+        
+        SsaIntLValueNode* def;
+        int phi;
+    };
+    
+    struct VarInfo
+    {
+        VarInfo(IntDeclNode* var_) : var(var_), lastDefBlock(-1), lastUseBlock(-1) { }
+        
+        IntDeclNode* var;
+        std::vector<int> defBlocks;
+        std::vector<int> liveInBlocks;
+        int lastDefBlock;
+        int lastUseBlock;
+        std::vector<SsaValue> activeValues;
+    };
+    
+    struct PhiInfo
+    {
+        PhiInfo(int var_, int block_) : var(var_), block(block_), value(nullptr) { }
+        
+        int var;
+        int block;
+        SparseBitVector defs;       // ssaIds of the definitions reaching the phi
+        std::vector<int> users;
+        SsaIntLValueNode* value;
+    };
+    
+    // A read (use != -1) or a definition of a variable, in program order
+    struct VarEvent
+    {
+        VarEvent(int var_, int use_, SsaIntLValueNode* def_) : var(var_), use(use_), def(def_) { }
+        
+        int var;
+        int use;
+        SsaIntLValueNode* def;
+    };
+    
+    void findDefsAndUses()
+    {
+        replacingUses = false;
+        
+        for(int i = 0; i < (int)programBody->statements.size(); ++i)
         {
-            auto block = workQueue.front();
-            workQueue.pop();
-            processBasicBlock(block);
+            currentBlock = i;
+            blockEvents.push_back(events.size());
+            programBody->statements[i]->acceptRecursive(*this);
         }
+        
+        blockEvents.push_back(events.size());
+        useValues.resize(totalUses, SsaValue(nullptr, -1));
     }
     
-private:
-    void processBasicBlock(BasicBlockNode* basicBlock)
+    void placePhiNodes(DominatorTree& dominatorTree)
     {
-        VarDefSet oldOutSet = basicBlock->varDefOut;
-        basicBlock->recalculateInSet();
+        int totalBlocks = dominatorTree.getTotalBlocks();
+        std::vector<int> definedIn(totalBlocks, -1);
+        std::vector<int> liveIn(totalBlocks, -1);
+        std::vector<int> visited(totalBlocks, -1);
+        std::vector<int> work;
         
-        basicBlock->varDefOut = basicBlock->varDefIn;
+        blockPhis.resize(totalBlocks);
         
-        for(StatementNode* s : basicBlock->statements)
+        for(int var = 0; var < (int)vars.size(); ++var)
         {
-            if(LetStatementNode* node = dynamic_cast<LetStatementNode*>(s))
+            for(int block : vars[var].defBlocks)
+                definedIn[block] = var;
+                
+            // The variable is live into every block that can reach one of its
+            // uses without passing through a definition
+            work = vars[var].liveInBlocks;
+            for(int block : work)
+                liveIn[block] = var;
+                
+            while(work.size() != 0)
+            {
+                int block = work.back();
+                work.pop_back();
+                
+                for(int predecessor : dominatorTree.getPredecessors(block))
+                {
+                    if(predecessor == dominatorTree.getRoot() || liveIn[predecessor] == var || definedIn[predecessor] == var)
+                        continue;
+                        
+                    liveIn[predecessor] = var;
+                    work.push_back(predecessor);
+                }
+            }
+            
+            // Place phi nodes on the iterated dominance frontier
+            work = vars[var].defBlocks;
+            
+            while(work.size() != 0)
             {
-                if(transformLetStatementToSsa(node, basicBlock))
+                int block = work.back();
+                work.pop_back();
+                
+                for(int frontierBlock : dominatorTree.getDominanceFrontier(block))
                 {
-                    basicBlock->varDefOut.replaceDefinition(dynamic_cast<SsaIntLValueNode*>(node->leftSide));
+                    if(visited[frontierBlock] == var)
+                        continue;
+                        
+                    visited[frontierBlock] = var;
+                    
+                    if(liveIn[frontierBlock] != var)
+                        continue;
+                        
+                    blockPhis[frontierBlock].push_back(phis.size());
+                    phis.push_back(PhiInfo(var, frontierBlock));
+                    
+                    if(definedIn[frontierBlock] != var)
+                        work.push_back(frontierBlock);
                 }
             }
         }
+    }
+    
+    void renameVars(DominatorTree& dominatorTree)
+    {
+        std::vector<int> pushedVars;
+        std::vector<int> pushedVarsMark(dominatorTree.getTotalBlocks());
+        
+        // Blocks to enter, and ~block for blocks to leave
+        std::vector<int> work(dominatorTree.getChildren(dominatorTree.getRoot()));
         
-        if(basicBlock->varDefOut != oldOutSet)
+        while(work.size() != 0)
         {
-            for(auto successor : basicBlock->successors)
-                workQueue.push(successor);
+            int block = work.back();
+            work.pop_back();
+            
+            if(block < 0)
+            {
+                block = ~block;
+                
+                while((int)pushedVars.size() > pushedVarsMark[block])
+                {
+                    vars[pushedVars.back()].activeValues.pop_back();
+                    pushedVars.pop_back();
+                }
+                
+                continue;
+            }
+            
+            pushedVarsMark[block] = pushedVars.size();
+            
+            for(int phi : blockPhis[block])
+            {
+                vars[phis[phi].var].activeValues.push_back(SsaValue(nullptr, phi));
+                pushedVars.push_back(phis[phi].var);
+            }
+            
+            for(int i = blockEvents[block]; i < blockEvents[block + 1]; ++i)
+            {
+                VarEvent& event = events[i];
+                
+                if(event.use != -1)
+                {
+                    useValues[event.use] = getActiveValue(event.var);
+                }
+                else
+                {
+                    vars[event.var].activeValues.push_back(SsaValue(event.def, -1));
+                    pushedVars.push_back(event.var);
+                }
+            }
+            
+            for(int successor : dominatorTree.getSuccessors(block))
+            {
+                for(int phi : blockPhis[successor])
+                    addPhiOperand(phi, getActiveValue(phis[phi].var));
+            }
+            
+            work.push_back(~block);
+            
+            for(int child : dominatorTree.getChildren(block))
+                work.push_back(child);
         }
     }
     
+    SsaValue getActiveValue(int var)
+    {
+        if(vars[var].activeValues.size() == 0)
+            return SsaValue(nullptr, -1);
+            
+        return vars[var].activeValues.back();
+    }
+    
+    void addPhiOperand(int phi, SsaValue value)
+    {
+        if(value.def)
+            phis[phi].defs.insert(value.def->ssaId);
+        else if(value.phi != -1)
+            phis[value.phi].users.push_back(phi);
+    }
+    
+    // Replaces phi nodes used as operands of other phi nodes with the
+    // definitions that reach them
+    void flattenPhiNodes()
+    {
+        std::vector<int> work;
+        std::vector<bool> queued(phis.size(), true);
+        
+        for(int i = (int)phis.size() - 1; i >= 0; --i)
+            work.push_back(i);
+            
+        while(work.size() != 0)
+        {
+            int phi = work.back();
+            work.pop_back();
+            queued[phi] = false;
+            
+            for(int user : phis[phi].users)
+            {
+                if(phis[user].defs.unionWith(phis[phi].defs) && !queued[user])
+                {
+                    queued[user] = true;
+                    work.push_back(user);
+                }
+            }
+        }
+    }
+    
+    void insertPhiNodes()
+    {
+        for(int i = 0; i < (int)programBody->statements.size(); ++i)
+        {
+            BasicBlockNode* block = cast<BasicBlockNode>(programBody->statements[i]);
+            std::vector<int> joins;
+            
+            for(int phi : blockPhis[i])
+            {
+                int totalDefs = phis[phi].defs.count();
+                
+                if(totalDefs == 1)
+                    phis[phi].value = ast.getSsaValue(phis[phi].defs.first());
+                else if(totalDefs > 1)
+                    joins.push_back(phi);
+            }
+            
+            if(joins.size() == 0)
+                continue;
+                
+            std::sort(joins.begin(), joins.end(), [this](int a, int b)
+            {
+                return vars[phis[a].var].var->varId < vars[phis[b].var].var->varId;
+            });
+            
+            std::vector<StatementNode*> phiNodes;
+            for(int phi : joins)
+                phiNodes.push_back(createTempJoin(phis[phi], block));
+                
+            auto it = block->statements.begin();
+            while(it != block->statements.end() && isa<LabelNode>(*it))
+                ++it;
+                
+            block->statements.insert(it, phiNodes.begin(), phiNodes.end());
+            totalPhiNodes += phiNodes.size();
+        }
+    }
+    
+    LetStatementNode* createTempJoin(PhiInfo& phi, BasicBlockNode* basicBlock)
+    {
+        SsaValueSet joinNodes;
+        phi.defs.forEach([&](int ssaId) { joinNodes.insert(ast.getSsaValue(ssaId)); });
+        
+        auto lValue = ast.addSsaIntLValueNode(ast.addIntLValue(vars[phi.var].var), basicBlock, nullptr);
+        
+        auto letStatement = ast.addLetStatementNode
+        (
+            lValue,
+            ast.addPhiNode(joinNodes)
+        );
+        
+        lValue->definitionNode = letStatement;
+        letStatement->parentBlock = basicBlock;
+        phi.value = lValue;
+        return letStatement;
+    }
+    
+    void replaceUses()
+    {
+        replacingUses = true;
+        nextUse = 0;
+        
+        for(StatementNode* s : programBody->statements)
+            s->acceptRecursive(*this);
+    }
+    
+    void visit(LetStatementNode* node)
+    {
+        if(replacingUses || !transformLetStatementToSsa(node, cast<BasicBlockNode>(programBody->statements[currentBlock])))
+            return;
+            
+        int var = getVarIndex(cast<SsaIntLValueNode>(node->leftSide)->var);
+        
+        if(vars[var].lastDefBlock != currentBlock)
+        {
+            vars[var].lastDefBlock = currentBlock;
+            vars[var].defBlocks.push_back(currentBlock);
+        }
+        
+        events.push_back(VarEvent(var, -1, cast<SsaIntLValueNode>(node->leftSide)));
+    }
+    
+    void visit(IntVarFactor* node)
+    {
+        if(replacingUses)
+        {
+            SsaValue value = useValues[nextUse++];
+            SsaIntLValueNode* def = value.phi != -1 ? phis[value.phi].value : value.def;
+            
+            if(!def)
+                throw "No defs for " + node->var->name;
+                
+            replaceNode(ast.addSsaIntVarFactorNode(def));
+            return;
+        }
+        
+        int var = getVarIndex(node->var);
+        
+        // Only reads that happen before any assignment in the block make the
+        // variable live into it
+        if(vars[var].lastDefBlock != currentBlock && vars[var].lastUseBlock != currentBlock)
+        {
+            vars[var].lastUseBlock = currentBlock;
+            vars[var].liveInBlocks.push_back(currentBlock);
+        }
+        
+        events.push_back(VarEvent(var, totalUses++, nullptr));
+    }
+    
+    int getVarIndex(IntDeclNode* var)
+    {
+        if(var->varId >= (int)varIndex.size())
+            varIndex.resize(ast.getTotalVars(), -1);
+            
+        int& index = varIndex[var->varId];
+        if(index == -1)
+        {
+            index = vars.size();
+            vars.push_back(VarInfo(var));
+        }
+        
+        return index;
+    }
+    
     bool transformLetStatementToSsa(LetStatementNode* node, BasicBlockNode* currentBlock)
     {
-        bool alreadyTransformed = dynamic_cast<SsaIntLValueNode*>(node->leftSide);
+        bool alreadyTransformed = isa<SsaIntLValueNode>(node->leftSide);
         if(alreadyTransformed)
             return true;
-        
-        IntLValueNode* intNode = dynamic_cast<IntLValueNode*>(node->leftSide);
+            
+        IntLValueNode* intNode = dyn_cast<IntLValueNode>(node->leftSide);
         if(!intNode)
             return false;
-        
+            
         node->leftSide = ast.addSsaIntLValueNode(intNode, currentBlock, node);
         return true;
     }
     
     CodeBlockNode* programBody;
     Ast& ast;
-    std::queue<BasicBlockNode*> workQueue;
+    
+    std::vector<int> varIndex;      // Indexed by varId, -1 if not seen yet
+    std::vector<VarInfo> vars;
+    std::vector<PhiInfo> phis;
+    std::vector<std::vector<int>> blockPhis;
+    
+    std::vector<VarEvent> events;
+    std::vector<int> blockEvents;
+    std::vector<SsaValue> useValues;
+    int totalUses;
+    int nextUse;
+    int currentBlock;
+    bool replacingUses;
+    int totalPhiNodes;
 };
-
@@ -3,13 +3,12 @@
 #include "Ast.hpp"
 #include "AstVisitor.hpp"
 #include "JoinNodeRemover.hpp"
-
-#include <typeinfo>
+#include "IdSet.hpp"
 
 class StatementKiller : AstVisitor
 {
 public:
-    StatementKiller(CodeBlockNode* programBody_, std::set<StatementNode*>& liveStatements_, std::set<StatementNode*>& killedStatements_)
+    StatementKiller(CodeBlockNode* programBody_, IdSet& liveStatements_, IdSet& killedStatements_)
         : programBody(programBody_),
         liveStatements(liveStatements_),
         killedStatements(killedStatements_),
@@ -19,6 +18,7 @@ public:
     bool killDeadStatements()
     {
         totalKilledStatements = 0;
+        killedLets.clear();
         success = false;
         programBody->acceptRecursive(*this);
         return success;
@@ -29,16 +29,21 @@ public:
         return totalKilledStatements;
     }
     
+    const std::vector<LetStatementNode*>& getKilledLets()
+    {
+        return killedLets;
+    }
+    
 private:
     void visit(StatementNode* node)
     {
-        if(dynamic_cast<CodeBlockNode*>(node))
+        if(isa<CodeBlockNode>(node))
             return;
         
         if(node->markedAsDead)
             return;
         
-        if(liveStatements.count(node) == 0 || killedStatements.count(node) != 0)
+        if(!liveStatements.contains(node->statementId) || killedStatements.contains(node->statementId))
         {
             node->markAsDead();
             success = true;
@@ -48,14 +53,14 @@ private:
     
     void visit(BasicBlockNode* node)
     {
-        if(killedStatements.count(node) == 0 || node->markedAsDead)
+        if(!killedStatements.contains(node->statementId) || node->markedAsDead)
             return;
         
         node->markAsDead();
         
         for(StatementNode* s : node->statements)
         {
-            killedStatements.insert(s);
+            killedStatements.insert(s->statementId);
             s->accept(*this);
         }
     }
@@ -66,26 +71,28 @@ private:
             return;
         
         // Special case: don't kill input nodes
-        if(dynamic_cast<InputIntNode*>(node->rightSide) && killedStatements.count(node) == 0)
+        if(isa<InputIntNode>(node->rightSide) && !killedStatements.contains(node->statementId))
             return;
         
-        if(liveStatements.count(node) == 0 || killedStatements.count(node) != 0)
+        if(!liveStatements.contains(node->statementId) || killedStatements.contains(node->statementId))
         {
-            if(auto lValue = dynamic_cast<SsaIntLValueNode*>(node->leftSide))
+            if(auto lValue = dyn_cast<SsaIntLValueNode>(node->leftSide))
             {
-                JoinNodeRemover remover(programBody, lValue);
+                JoinNodeRemover remover(lValue);
                 remover.removeFromJoinNodes();
             }
             
             node->markAsDead();
+            killedLets.push_back(node);
             success = true;
             ++totalKilledStatements;
         }
     }
     
     CodeBlockNode* programBody;
-    std::set<StatementNode*>& liveStatements;
-    std::set<StatementNode*>& killedStatements;
+    IdSet& liveStatements;
+    IdSet& killedStatements;
+    std::vector<LetStatementNode*> killedLets;
     bool success;
     int totalKilledStatements;
 };
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstring>
+
+// An interned name. Every occurrence of the same identifier shares one Symbol,
+// so names can be compared by pointer (or by id).
+struct Symbol
+{
+    Symbol(const char* begin, const char* end, int id_) : name(begin, end), id(id_) { }
+    
+    std::string name;
+    int id;
+};
+
+// Interns identifiers. The lexer interns every identifier straight out of the
+// source buffer and the parser and AST share the resulting symbols. Lookups
+// hash the characters in place, so a name that has been seen before doesn't
+// allocate anything.
+class SymbolTable
+{
+public:
+    SymbolTable() : slots(64) { }
+    
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+    
+    Symbol* intern(const char* begin, const char* end)
+    {
+        unsigned int hash = hashName(begin, end);
+        size_t length = end - begin;
+        size_t mask = slots.size() - 1;
+        size_t i = hash & mask;
+        
+        while(slots[i].symbol)
+        {
+            Symbol* symbol = slots[i].symbol;
+            
+            if(slots[i].hash == hash && symbol->name.length() == length && memcmp(symbol->name.data(), begin, length) == 0)
+                return symbol;
+                
+            i = (i + 1) & mask;
+        }
+        
+        symbols.push_back(Symbol(begin, end, symbols.size()));
+        slots[i].hash = hash;
+        slots[i].symbol = &symbols.back();
+        
+        // Keep the table at most half full
+        if(symbols.size() * 2 > slots.size())
+            grow();
+            
+        return &symbols.back();
+    }
+    
+    Symbol* intern(const std::string& name)
+    {
+        return intern(name.data(), name.data() + name.length());
+    }
+    
+    Symbol* getSymbol(int id)
+    {
+        return &symbols[id];
+    }
+    
+    int getTotalSymbols()
+    {
+        return symbols.size();
+    }
+    
+private:
+    struct Slot
+    {
+        Slot() : hash(0), symbol(nullptr) { }
+        
+        unsigned int hash;
+        Symbol* symbol;
+    };
+    
+    // FNV-1a
+    static unsigned int hashName(const char* begin, const char* end)
+    {
+        unsigned int hash = 2166136261u;
+        
+        for(const char* c = begin; c < end; ++c)
+        {
+            hash ^= (unsigned char)*c;
+            hash *= 16777619u;
+        }
+        
+        return hash;
+    }
+    
+    void grow()
+    {
+        std::vector<Slot> oldSlots(slots.size() * 2);
+        oldSlots.swap(slots);
+        
+        size_t mask = slots.size() - 1;
+        
+        for(Slot& slot : oldSlots)
+        {
+            if(!slot.symbol)
+                continue;
+                
+            size_t i = slot.hash & mask;
+            while(slots[i].symbol)
+                i = (i + 1) & mask;
+                
+            slots[i] = slot;
+        }
+    }
+    
+    // A deque so symbols never move once they've been handed out
+    std::deque<Symbol> symbols;
+    std::vector<Slot> slots;
+};
@@ -1,56 +1,8 @@
 #include <map>
-#include <map>
+#include <cstring>
 
 #include "Token.hpp"
 
-static std::map<std::string, TokenType> languageKeywords =
-{
-    { "begin", TOK_BEGIN },
-    { "by", TOK_BY },
-    { "endfor", TOK_ENDFOR },
-    { "end", TOK_END },
-    { "endwhile", TOK_ENDWHILE },
-    { "for", TOK_FOR },
-    { "goto", TOK_GOTO },
-    { "if", TOK_IF },
-    { "input", TOK_INPUT },
-    { "int", TOK_INT },
-    { "label", TOK_LABEL },
-    { "let", TOK_LET },
-    { "list", TOK_LIST },
-    { "print", TOK_PRINT },
-    { "prompt", TOK_PROMPT },
-    { "rem", TOK_REM },
-    { "then", TOK_THEN },
-    { "title", TOK_TITLE },
-    { "to", TOK_TO },
-    { "var", TOK_VAR },
-    { "while", TOK_WHILE },
-    { "box", TOK_BOX },
-    { "table", TOK_TABLE }
-};
-
-static std::map<std::string, TokenType> operators =
-{
-    { "==", TOK_EQ },
-    { "!=", TOK_NE },
-    { "=", TOK_ASSIGN },
-    { "<", TOK_LT },
-    { ">", TOK_GT },
-    { "<=", TOK_LE },
-    { ">=", TOK_GE },
-    { "[", TOK_LSQUARE_BRACKET },
-    { "]", TOK_RSQUARE_BRACKET },
-    { "+", TOK_ADD },
-    { "-", TOK_SUB },
-    { "/", TOK_DIV },
-    { "*", TOK_MUL },
-    { "%", TOK_MOD },
-    { "(", TOK_LPAREN },
-    { ")", TOK_RPAREN },
-    { ",", TOK_COMMA }
-};
-
 bool Token::isComparisonOperator(TokenType type)
 {
     return type == TOK_EQ || type == TOK_LT || type == TOK_GT || type == TOK_LE || type == TOK_GE || type == TOK_NE;
@@ -104,22 +56,128 @@ static std::map<TokenType, std::string> tokenNames =
     { TOK_COMMA, "," }
 };
 
-TokenType Token::getKeywordType(std::string keyword)
+static bool matches(const char* text, const char* word, int length)
+{
+    return memcmp(text, word, length) == 0;
+}
+
+// Keywords are told apart by their length and first character, so at most one
+// comparison is made per identifier
+TokenType Token::getKeywordType(const char* text, int length)
 {
-    if(languageKeywords.count(keyword) != 0)
-        return languageKeywords[keyword];
+    switch(length)
+    {
+        case 2:
+            switch(text[0])
+            {
+                case 'b': return matches(text, "by", 2) ? TOK_BY : TOK_INVALID;
+                case 'i': return matches(text, "if", 2) ? TOK_IF : TOK_INVALID;
+                case 't': return matches(text, "to", 2) ? TOK_TO : TOK_INVALID;
+            }
+            break;
+
+        case 3:
+            switch(text[0])
+            {
+                case 'b': return matches(text, "box", 3) ? TOK_BOX : TOK_INVALID;
+                case 'e': return matches(text, "end", 3) ? TOK_END : TOK_INVALID;
+                case 'f': return matches(text, "for", 3) ? TOK_FOR : TOK_INVALID;
+                case 'i': return matches(text, "int", 3) ? TOK_INT : TOK_INVALID;
+                case 'l': return matches(text, "let", 3) ? TOK_LET : TOK_INVALID;
+                case 'r': return matches(text, "rem", 3) ? TOK_REM : TOK_INVALID;
+                case 'v': return matches(text, "var", 3) ? TOK_VAR : TOK_INVALID;
+            }
+            break;
+
+        case 4:
+            switch(text[0])
+            {
+                case 'g': return matches(text, "goto", 4) ? TOK_GOTO : TOK_INVALID;
+                case 'l': return matches(text, "list", 4) ? TOK_LIST : TOK_INVALID;
+                case 't': return matches(text, "then", 4) ? TOK_THEN : TOK_INVALID;
+            }
+            break;
+
+        case 5:
+            switch(text[0])
+            {
+                case 'b': return matches(text, "begin", 5) ? TOK_BEGIN : TOK_INVALID;
+                case 'i': return matches(text, "input", 5) ? TOK_INPUT : TOK_INVALID;
+                case 'l': return matches(text, "label", 5) ? TOK_LABEL : TOK_INVALID;
+                case 'p': return matches(text, "print", 5) ? TOK_PRINT : TOK_INVALID;
+                case 't':
+                    if(matches(text, "title", 5)) return TOK_TITLE;
+                    if(matches(text, "table", 5)) return TOK_TABLE;
+                    break;
+                case 'w': return matches(text, "while", 5) ? TOK_WHILE : TOK_INVALID;
+            }
+            break;
+
+        case 6:
+            switch(text[0])
+            {
+                case 'e': return matches(text, "endfor", 6) ? TOK_ENDFOR : TOK_INVALID;
+                case 'p': return matches(text, "prompt", 6) ? TOK_PROMPT : TOK_INVALID;
+            }
+            break;
+
+        case 8:
+            return matches(text, "endwhile", 8) ? TOK_ENDWHILE : TOK_INVALID;
+    }
 
     return TOK_INVALID;
 }
 
-TokenType Token::getOperatorType(std::string op)
+TokenType Token::getOperatorType(const char* text, int length)
 {
-    if(operators.count(op) != 0)
-        return operators[op];
+    if(length == 2)
+    {
+        if(text[1] != '=')
+            return TOK_INVALID;
+
+        switch(text[0])
+        {
+            case '=': return TOK_EQ;
+            case '!': return TOK_NE;
+            case '<': return TOK_LE;
+            case '>': return TOK_GE;
+        }
+
+        return TOK_INVALID;
+    }
+
+    if(length != 1)
+        return TOK_INVALID;
+
+    switch(text[0])
+    {
+        case '=': return TOK_ASSIGN;
+        case '<': return TOK_LT;
+        case '>': return TOK_GT;
+        case '[': return TOK_LSQUARE_BRACKET;
+        case ']': return TOK_RSQUARE_BRACKET;
+        case '+': return TOK_ADD;
+        case '-': return TOK_SUB;
+        case '/': return TOK_DIV;
+        case '*': return TOK_MUL;
+        case '%': return TOK_MOD;
+        case '(': return TOK_LPAREN;
+        case ')': return TOK_RPAREN;
+        case ',': return TOK_COMMA;
+    }
 
     return TOK_INVALID;
 }
 
+int Token::getIntValue() const
+{
+    unsigned int value = 0;
+    for(int i = 0; i < length; ++i)
+        value = value * 10 + (text[i] - '0');
+
+    return (int)value;
+}
+
 std::string Token::getTokenName(TokenType inToken)
 {
     if (tokenNames.count(inToken)!= 0)
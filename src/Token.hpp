@@ -50,19 +50,26 @@ enum TokenType
     TOK_COMMA
 };
 
+struct Symbol;
+
 struct Token
 {
-    Token(TokenType type_, std::string value_, int line_, int col_)
-        : type(type_), value(value_), line(line_), col(col_) { }
+    Token(TokenType type_, const char* text_, int length_, int offset_)
+        : type(type_), text(text_), length(length_), symbol(nullptr), offset(offset_) { }
+
+    // The text points into the source buffer, which has to outlive the tokens
+    std::string getValue() const { return std::string(text, length); }
+    int getIntValue() const;
 
     TokenType type;
-    std::string value;
+    const char* text;
+    int length;
+    Symbol* symbol;     // Interned name of an identifier
 
-    int line;
-    int col;
+    int offset;         // Byte offset into the source, or -1
 
-    static TokenType getKeywordType(std::string keyword);
-    static TokenType getOperatorType(std::string op);
+    static TokenType getKeywordType(const char* text, int length);
+    static TokenType getOperatorType(const char* text, int length);
     static bool isComparisonOperator(TokenType type);
     static std::string getTokenName(TokenType inToken);
 };
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include "Token.hpp"
+#include "Lexer.hpp"
+#include "ParallelLexer.hpp"
+#include "Error.hpp"
+
+// Pulls tokens from the lexer (or a ParallelLexer) as the parser asks for
+// them, so the whole program is never held as a vector of tokens. Tokens are
+// numbered in the order they're lexed and only the last few are kept in a ring
+// buffer, which is enough for the parser's one token of lookahead and the
+// single token it backs up over when reporting errors.
+class TokenStream
+{
+public:
+    TokenStream(Lexer& lexer_)
+        : lexer(&lexer_),
+        parallelLexer(nullptr),
+        ring(RING_SIZE, Token(TOK_INVALID, "", 0, -1)),
+        totalLexed(0),
+        reachedEnd(false) { }
+        
+    // The parallel lexer has to have lexed its chunks already
+    TokenStream(ParallelLexer& parallelLexer_)
+        : lexer(nullptr),
+        parallelLexer(&parallelLexer_),
+        ring(RING_SIZE, Token(TOK_INVALID, "", 0, -1)),
+        totalLexed(0),
+        reachedEnd(false) { }
+        
+    // Returns the token with the given number, or nullptr if the input ends
+    // before it
+    Token* getToken(int id)
+    {
+        while(id >= totalLexed && !reachedEnd)
+        {
+            Token& token = ring[totalLexed & (RING_SIZE - 1)];
+            
+            if(lexer ? lexer->nextToken(token) : parallelLexer->nextToken(token))
+                ++totalLexed;
+            else
+                reachedEnd = true;
+        }
+        
+        if(id >= totalLexed)
+            return nullptr;
+            
+        // Only the last RING_SIZE tokens are kept. Asking for an older one is a
+        // bug in the parser, but it has to fail even in a release build rather
+        // than hand back whichever token has taken its slot.
+        if(id <= totalLexed - RING_SIZE)
+        {
+            int offset = ring[(totalLexed - 1) & (RING_SIZE - 1)].offset;
+            throw CompileError("Programmer error: token " + std::to_string(id) + " is no longer buffered", "Parsing", offset);
+        }
+        
+        return &ring[id & (RING_SIZE - 1)];
+    }
+    
+private:
+    static const int RING_SIZE = 4;
+    
+    Lexer* lexer;
+    ParallelLexer* parallelLexer;
+    std::vector<Token> ring;
+    int totalLexed;
+    bool reachedEnd;
+};
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdio>
+#include <chrono>
+#include <algorithm>
+
+#include "BenchmarkBase.hpp"
+#include "AstVisitor.hpp"
+#include "AstWalker.hpp"
+#include "StaticVisitor.hpp"
+#include "CfgAnalysis.hpp"
+#include "SsaBuilder.hpp"
+#include "DefUseBuilder.hpp"
+#include "OptimizerWorklist.hpp"
+#include "ConstantPropagator.hpp"
+#include "DeadCodeEliminator.hpp"
+#include "CopyPropagator.hpp"
+#include "RedundantVariableRemover.hpp"
+
+// Walks the whole program the ways the passes do, and before and after the
+// statements the optimizer kills are compacted away
+class TraversalBenchmark : BenchmarkBase
+{
+public:
+    TraversalBenchmark(SourceBuffer& source_) : BenchmarkBase(source_) { }
+    
+    void run()
+    {
+        benchmarkTraversal();
+        benchmarkCompaction();
+    }
+    
+private:
+    // Walks the whole program with acceptRecursive, which recurses as long as
+    // the tree isn't too deep, and with AstWalker, which never does
+    void benchmarkTraversal()
+    {
+        auto parsed = parseSource();
+        Ast& ast = parsed->ast;
+        
+        double bestRecursive = 0;
+        double bestIterative = 0;
+        double bestStatic = 0;
+        NodeCounter counter;
+        StaticNodeCounter staticCounter;
+        
+        for(int i = 0; i < TOTAL_RUNS; ++i)
+        {
+            auto startTime = std::chrono::steady_clock::now();
+            
+            counter.totalNodes = 0;
+            ast.getBody()->acceptRecursive(counter);
+            
+            auto walkerTime = std::chrono::steady_clock::now();
+            
+            counter.totalNodes = 0;
+            AstWalker::walk<AstVisitor>(ast.getBody(), counter);
+            
+            auto staticTime = std::chrono::steady_clock::now();
+            
+            staticCounter.totalNodes = 0;
+            staticCounter.walk(ast.getBody());
+            
+            auto endTime = std::chrono::steady_clock::now();
+            
+            double recursiveTime = getMilliseconds(startTime, walkerTime);
+            double iterativeTime = getMilliseconds(walkerTime, staticTime);
+            double staticVisitorTime = getMilliseconds(staticTime, endTime);
+            
+            if(i == 0 || recursiveTime < bestRecursive)
+                bestRecursive = recursiveTime;
+            if(i == 0 || iterativeTime < bestIterative)
+                bestIterative = iterativeTime;
+            if(i == 0 || staticVisitorTime < bestStatic)
+                bestStatic = staticVisitorTime;
+        }
+        
+        printf("Traversal: %d nodes, %d deep\n", counter.totalNodes, counter.maxDepth);
+        printf("Traversal, acceptRecursive: %.3f ms (%.1f M nodes/s)\n", bestRecursive, counter.totalNodes / bestRecursive / 1000);
+        printf("Traversal, AstWalker: %.3f ms (%.1f M nodes/s)\n", bestIterative, counter.totalNodes / bestIterative / 1000);
+        printf("Traversal, StaticVisitor: %.3f ms (%.1f M nodes/s)\n", bestStatic, staticCounter.totalNodes / bestStatic / 1000);
+    }
+    
+    // Runs the optimizer's passes until they stop changing anything, without
+    // removing the statements they kill along the way, and walks the program
+    // before and after removing them all at once
+    void benchmarkCompaction()
+    {
+        auto parsed = parseSource();
+        Ast& ast = parsed->ast;
+        
+        ast.defaultInitializeVars();
+        ast.splitIntoBasicBlocks();
+        
+        CodeBlockNode* programBody = ast.getBody();
+        CfgAnalysis cfg(programBody);
+        
+        SsaBuilder ssaBuilder(programBody, ast);
+        ssaBuilder.buildSsa(cfg.getDominatorTree());
+        
+        DefUseBuilder defUseBuilder;
+        defUseBuilder.buildDefUseChains(programBody);
+        
+        OptimizerWorklist worklist(programBody, cfg);
+        ConstantPropagator constantPropagator(programBody, ast);
+        DeadCodeEliminator eliminator(programBody);
+        CopyPropagator copyPropagator(programBody, ast);
+        RedundantVariableRemover varRemover(programBody);
+        
+        int totalRounds = 0;
+        bool changed = true;
+        
+        while(changed)
+        {
+            changed = false;
+            changed |= constantPropagator.propagateConstants(worklist);
+            changed |= eliminator.eliminateDeadCode(worklist);
+            changed |= copyPropagator.propagateCopies(worklist);
+            changed |= varRemover.removeRedundantVariables(worklist);
+            ++totalRounds;
+        }
+        
+        StaticNodeCounter counter;
+        double bestBefore = bestTime([&]() { counter.walk(programBody); });
+        
+        int totalRemoved = worklist.removeDeadStatements(programBody);
+        double bestAfter = bestTime([&]() { counter.walk(programBody); });
+        
+        printf("Compaction: %d dead statements removed after %d rounds\n", totalRemoved, totalRounds);
+        printf("Compaction, traversal: %.3f ms before, %.3f ms after (%.2fx)\n", bestBefore, bestAfter, bestBefore / bestAfter);
+    }
+    
+    // Counts the expressions and statements it's walked over
+    struct NodeCounter : AstVisitor
+    {
+        NodeCounter() : totalNodes(0), maxDepth(0) { }
+        
+        void visit(StatementNode* node) { count(); }
+        void visit(ExpressionNode* node) { count(); }
+        
+        void count()
+        {
+            ++totalNodes;
+            maxDepth = std::max(maxDepth, (int)nodeStack.size());
+        }
+        
+        int totalNodes;
+        int maxDepth;
+    };
+    
+    struct StaticNodeCounter : StaticVisitor<StaticNodeCounter>
+    {
+        StaticNodeCounter() : totalNodes(0) { }
+        
+        using StaticVisitor<StaticNodeCounter>::visit;
+        
+        static const bool replacesNodes = false;
+        
+        void visit(StatementNode* node) { ++totalNodes; }
+        void visit(ExpressionNode* node) { ++totalNodes; }
+        
+        int totalNodes;
+    };
+};
@@ -2,23 +2,53 @@
 
 #include "Ast.hpp"
 #include "AstVisitor.hpp"
-#include "JoinNodeRemover.hpp"
+#include "DefUseBuilder.hpp"
 
 class VariableReplacer : AstVisitor
 {
 public:
-    VariableReplacer(CodeBlockNode* programBody_, SsaIntLValueNode* nodeToReplace_, ExpressionNode* replacement_)
-        : programBody(programBody_), nodeToReplace(nodeToReplace_), replacement(replacement_) { }    
-    
+    VariableReplacer(SsaIntLValueNode* nodeToReplace_, ExpressionNode* replacement_)
+        : nodeToReplace(nodeToReplace_), replacement(replacement_) { }
+        
     bool replaceVars()
     {
         success = false;
-        programBody->acceptRecursive(*this);
+        changedStatements.clear();
         
-        //JoinNodeRemover remover(programBody, nodeToReplace);
-        //success |= remover.removeFromJoinNodes();
+        // Iterate over a copy since the replacement may itself use nodeToReplace
+        StatementSet users = nodeToReplace->users;
         
-        return success;
+        for(StatementNode* user : users)
+        {
+            if(user->inDeadCode())
+                continue;
+                
+            replacedInStatement = false;
+            user->acceptRecursive(*this);
+            
+            success |= replacedInStatement;
+            changedStatements.push_back(user);
+        }
+        
+        if(!success)
+        {
+            changedStatements.clear();
+            return false;
+        }
+        
+        // Expressions can be shared between statements (see
+        // RedundantVariableRemover), so a user may have changed even if the
+        // replacement was made through another statement
+        DefUseBuilder builder;
+        for(StatementNode* user : changedStatements)
+            builder.addUses(replacement, user);
+        
+        return true;
+    }
+    
+    const std::vector<StatementNode*>& getChangedStatements()
+    {
+        return changedStatements;
     }
     
 private:
@@ -27,13 +57,13 @@ private:
         if(node->ssaLValue == nodeToReplace)
         {
             replaceNode(replacement);
-            success = true;
+            replacedInStatement = true;
         }
     }
     
-    CodeBlockNode* programBody;
     SsaIntLValueNode* nodeToReplace;
     ExpressionNode* replacement;
+    std::vector<StatementNode*> changedStatements;
     bool success;
+    bool replacedInStatement;
 };
-
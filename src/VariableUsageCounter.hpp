@@ -1,6 +1,6 @@
 #pragma once
 
-#include <map>
+#include <vector>
 
 #include "Ast.hpp"
 #include "AstVisitor.hpp"
@@ -11,7 +11,9 @@ public:
     VariableUsageCounter(CodeBlockNode* programBody_, bool includeLValues_ = false, bool includeFactors_ = true, bool includePhiNodes_ = true)
         : programBody(programBody_), includeLValues(includeLValues_), includeFactors(includeFactors_), includePhiNodes(includePhiNodes_) { }
     
-    std::map<SsaIntLValueNode*, int> countVarUses()
+    // Number of uses of each SSA value, indexed by ssaId. Values past the end
+    // of the vector aren't used at all.
+    const std::vector<int>& countVarUses()
     {
         useCounter.clear();
         programBody->acceptRecursive(*this);
@@ -24,7 +26,7 @@ private:
         if(!includeFactors)
             return;
         
-        ++useCounter[node->ssaLValue];
+        addUse(node->ssaLValue);
     }
     
     void visit(PhiNode* node)
@@ -33,7 +35,7 @@ private:
             return;
         
         for(auto joinNode : node->joinNodes)
-            ++useCounter[joinNode];
+            addUse(joinNode);
     }
     
     void visit(SsaIntLValueNode* node)
@@ -41,11 +43,19 @@ private:
         if(!includeLValues)
             return;
         
-        ++useCounter[node];
+        addUse(node);
+    }
+    
+    void addUse(SsaIntLValueNode* node)
+    {
+        if(node->ssaId >= (int)useCounter.size())
+            useCounter.resize(node->ssaId + 1, 0);
+            
+        ++useCounter[node->ssaId];
     }
     
     CodeBlockNode* programBody;
-    std::map<SsaIntLValueNode*, int> useCounter;
+    std::vector<int> useCounter;
     bool includeLValues;
     bool includeFactors;
     bool includePhiNodes;
@@ -1,7 +1,10 @@
 #include <iostream>
 #include <cstring>
+#include <thread>
+#include <algorithm>
 
 #include "Lexer.hpp"
+#include "ParallelLexer.hpp"
 #include "File.hpp"
 #include "Ast.hpp"
 #include "Parser.hpp"
@@ -9,19 +12,25 @@
 #include "Error.hpp"
 #include "Optimizer.hpp"
 #include "PolynomialSimplifier.hpp"
+#include "Benchmark.hpp"
 
-void compileSource(std::string inputFile, std::string outputFile, bool enableOptimizations, bool printResult)
+void compileSource(std::string inputFile, std::string outputFile, bool enableOptimizations, bool structureControlFlow, bool printResult, bool printMemoryStats, int lexThreads)
 {
-    std::string input;
+    SourceBuffer input(inputFile);
     
     try
     {
-        input = readFileContents(inputFile);
+        SymbolTable symbols;
+        
+        Lexer lexer(input.begin(), input.end(), symbols);
+        ParallelLexer parallelLexer(input.begin(), input.end(), symbols, lexThreads);
+        
+        if(lexThreads > 1)
+            parallelLexer.lexChunks();
             
-        Lexer lexer(input);
-        std::vector<Token>& tokens = lexer.lexTokens();
+        TokenStream tokens = lexThreads > 1 ? TokenStream(parallelLexer) : TokenStream(lexer);
         
-        Parser parser(tokens);
+        Parser parser(tokens, symbols);
         Ast& ast = parser.parse();
         
         ast.defaultInitializeVars();
@@ -35,7 +44,7 @@ void compileSource(std::string inputFile, std::string outputFile, bool enableOpt
         
         PolynomialSimplifier polySimplifier(ast, ast.getBody());
         
-        CodeGenerator gen;
+        CodeGenerator gen(structureControlFlow);
         gen.genCode(ast);
         
         writeFileContents(outputFile, gen.output);
@@ -48,12 +57,15 @@ void compileSource(std::string inputFile, std::string outputFile, bool enableOpt
             }
         }
         
+        if(printMemoryStats)
+            ast.printMemoryStats();
+        
         std::cout << "\n";
         std::cout << "Compilation successful (written to " << outputFile << ")\n"; 
     }
     catch(CompileError& err)
     {
-        err.print(input);
+        err.print(input.getLineIndex());
         throw;
     }
 }
@@ -61,7 +73,11 @@ void compileSource(std::string inputFile, std::string outputFile, bool enableOpt
 int main(int argc, char* argv[])
 {
     bool enableOptimizations = true;
+    bool structureControlFlow = true;
     bool printResult = false;
+    bool printMemoryStats = false;
+    bool runBenchmarks = false;
+    int lexThreads = 1;
     
     if(argc < 3)
     {
@@ -73,13 +89,30 @@ int main(int argc, char* argv[])
     {
         if(strcmp(argv[i], "--noopt") == 0)
             enableOptimizations = false;
+        else if(strcmp(argv[i], "--gotos") == 0)
+            structureControlFlow = false;
         else if(strcmp(argv[i], "--print") == 0)
             printResult = true;
+        else if(strcmp(argv[i], "--memstats") == 0)
+            printMemoryStats = true;
+        else if(strcmp(argv[i], "--bench") == 0)
+            runBenchmarks = true;
+        else if(strcmp(argv[i], "--parallel-lex") == 0)
+            lexThreads = std::max(1u, std::thread::hardware_concurrency());
     }
     
     try
     {
-        compileSource(argv[1], argv[2], enableOptimizations, printResult);
+        if(runBenchmarks)
+        {
+            SourceBuffer source(argv[1]);
+            Benchmark benchmark(source);
+            benchmark.run();
+        }
+        else
+        {
+            compileSource(argv[1], argv[2], enableOptimizations, structureControlFlow, printResult, printMemoryStats, lexThreads);
+        }
     }
     catch(const char* str)
     {